@@ -0,0 +1,340 @@
+#include "Benchmarks.hpp"
+
+#include "CompiledSchema.hpp"
+#include "Schema.hpp"
+#include "Validation.hpp"
+
+#include <Array.hpp>
+#include <Control.hpp>
+#include <OS.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+// Large enough for native recursion over a 1000 deep schema to show up in `stack_used` instead of crashing
+static constexpr size_t STACK_SIZE = 8 * 1024 * 1024;
+static constexpr int RUNS = 3;
+static constexpr uint8_t STACK_FILL = 0xA5;
+
+static int64_t now_usec() {
+	return OS::get_singleton()->get_ticks_usec();
+}
+
+/// Runs `fn` on a thread with a stack of STACK_SIZE bytes, and returns how many of them it touched.
+/// Returns -1 where the stack can't be provided by us, `fn` then runs on the calling thread.
+static int64_t run_measuring_stack(const std::function<void()>& fn) {
+#ifndef _WIN32
+	void* stack = nullptr;
+	if (posix_memalign(&stack, 64 * 1024, STACK_SIZE) != 0) {
+		fn();
+		return -1;
+	}
+	std::memset(stack, STACK_FILL, STACK_SIZE);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, stack, STACK_SIZE);
+	pthread_t thread;
+	auto entry = [](void* arg) -> void* {
+		(*static_cast<const std::function<void()>*>(arg))();
+		return nullptr;
+	};
+	bool started = pthread_create(&thread, &attr, entry, const_cast<std::function<void()>*>(&fn)) == 0;
+	pthread_attr_destroy(&attr);
+	if (!started) {
+		std::free(stack);
+		fn();
+		return -1;
+	}
+	pthread_join(thread, nullptr);
+
+	// The stack grows down, so everything above the lowest overwritten byte was used
+	auto bytes = static_cast<const uint8_t*>(stack);
+	size_t untouched = 0;
+	while (untouched < STACK_SIZE && bytes[untouched] == STACK_FILL) {
+		++untouched;
+	}
+	std::free(stack);
+	return static_cast<int64_t>(STACK_SIZE - untouched);
+#else
+	fn();
+	return -1;
+#endif
+}
+
+/// A schema definition (in the format of ResourceSchema) and a value that matches it
+struct SchemaCase {
+	String shape;
+	Dictionary def;
+	Variant value;
+	int64_t nodes;
+	int64_t depth;
+};
+
+/// `depth` structs, each with a single field holding the next one, and an int at the bottom
+static SchemaCase make_deep_struct(int depth) {
+	Dictionary def;
+	def["name"] = "child";
+	def["type"] = "int";
+	Variant value = 0;
+	for (int i = 0; i < depth; ++i) {
+		Dictionary parent_def;
+		parent_def["name"] = "child";
+		parent_def["type"] = "struct";
+		parent_def["fields"] = Array::make(def);
+		Dictionary parent_value;
+		parent_value["child"] = value;
+		def = parent_def;
+		value = parent_value;
+	}
+	return { "deep_struct", def, value, depth + 1, depth + 1 };
+}
+
+/// `depth` arrays, each with the next one as its element type, and an int at the bottom
+static SchemaCase make_deep_array(int depth) {
+	Dictionary def;
+	def["type"] = "int";
+	Variant value = 0;
+	for (int i = 0; i < depth; ++i) {
+		Dictionary parent_def;
+		parent_def["type"] = "array";
+		parent_def["element_type"] = def;
+		def = parent_def;
+		value = Array::make(value);
+	}
+	return { "deep_array", def, value, depth + 1, depth + 1 };
+}
+
+/// About `nodes` nodes in groups of a struct with 9 int fields, the groups differ so that compiling can't share them
+static SchemaCase make_wide_struct(int nodes) {
+	static const int group_size = 10;
+	int group_count = std::max(nodes / group_size, 1);
+	Array groups;
+	Dictionary value;
+	for (int i = 0; i < group_count; ++i) {
+		Array fields;
+		Dictionary group_value;
+		for (int j = 0; j < group_size - 1; ++j) {
+			String name = "f" + String::num_int64(j);
+			Dictionary field;
+			field["name"] = name;
+			field["type"] = "int";
+			field["min_value"] = i;
+			fields.append(field);
+			group_value[name] = i;
+		}
+		String name = "g" + String::num_int64(i);
+		Dictionary group;
+		group["name"] = name;
+		group["type"] = "struct";
+		group["fields"] = fields;
+		groups.append(group);
+		value[name] = group_value;
+	}
+
+	Dictionary def;
+	def["type"] = "struct";
+	def["fields"] = groups;
+	return { "wide_struct", def, value, 1 + group_count * group_size, 3 };
+}
+
+/// Runs every traversal over `c` RUNS times on a thread of its own, keeping the fastest time of each step
+static Dictionary run_schema_case(const SchemaCase& c) {
+	struct Timings {
+		int64_t parse = INT64_MAX;
+		int64_t save = INT64_MAX;
+		int64_t clone = INT64_MAX;
+		int64_t compile = INT64_MAX;
+		int64_t validate = INT64_MAX;
+		int64_t free = INT64_MAX;
+		size_t errors = 0;
+		bool ok = true;
+	} t;
+	// The dictionaries made by save_schema() are freed by the engine, recursively, so that happens out here
+	Dictionary saved;
+	int64_t stack_used = -1;
+
+	for (int run = 0; run < RUNS && t.ok; ++run) {
+		stack_used = std::max(stack_used, run_measuring_stack([&]() {
+			auto start = now_usec();
+			auto schema = parse_schema(c.def);
+			t.parse = std::min(t.parse, now_usec() - start);
+			if (!schema) {
+				t.ok = false;
+				return;
+			}
+
+			start = now_usec();
+			saved = save_schema(schema.get());
+			t.save = std::min(t.save, now_usec() - start);
+
+			start = now_usec();
+			auto clone = schema->clone_uptr();
+			t.clone = std::min(t.clone, now_usec() - start);
+
+			start = now_usec();
+			auto compiled = CompiledSchema::compile(*schema);
+			t.compile = std::min(t.compile, now_usec() - start);
+
+			start = now_usec();
+			t.errors = validate(compiled, *compiled.find_root(""), c.value).size();
+			t.validate = std::min(t.validate, now_usec() - start);
+
+			start = now_usec();
+			schema.reset();
+			clone.reset();
+			t.free = std::min(t.free, now_usec() - start);
+		}));
+		saved = Dictionary{};
+	}
+
+	Dictionary result;
+	result["shape"] = c.shape;
+	result["nodes"] = c.nodes;
+	result["depth"] = c.depth;
+	result["ok"] = t.ok;
+	if (!t.ok) {
+		return result;
+	}
+	result["parse_usec"] = t.parse;
+	result["save_usec"] = t.save;
+	result["clone_usec"] = t.clone;
+	result["compile_usec"] = t.compile;
+	result["validate_usec"] = t.validate;
+	result["free_usec"] = t.free;
+	auto total = t.parse + t.save + t.clone + t.compile + t.validate + t.free;
+	result["ns_per_node"] = static_cast<double>(total) * 1000 / c.nodes;
+	// The generated values are valid, anything else means the benchmark measured the wrong thing
+	result["errors"] = static_cast<int64_t>(t.errors);
+	result["stack_used"] = stack_used;
+	return result;
+}
+
+Dictionary Benchmarks::run_schema_benchmarks() {
+	std::vector<SchemaCase> cases;
+	for (int depth : { 10, 100, 1000 }) {
+		cases.push_back(make_deep_struct(depth));
+	}
+	for (int depth : { 10, 100, 1000 }) {
+		cases.push_back(make_deep_array(depth));
+	}
+	for (int nodes : { 1000, 10000, 100000 }) {
+		cases.push_back(make_wide_struct(nodes));
+	}
+
+	Array results;
+	for (auto& c : cases) {
+		results.append(run_schema_case(c));
+	}
+
+	Dictionary report;
+	report["cases"] = results;
+	report["stack_size"] = static_cast<int64_t>(STACK_SIZE);
+	return report;
+}
+
+void BenchmarkList::_notification(int what) {
+	ListContainer::_notification(what);
+}
+
+Size2 BenchmarkList::_get_minimum_size() {
+	return ListContainer::_get_minimum_size();
+}
+
+void BenchmarkList::relayout() {
+	_get_minimum_size();
+	_notification(NOTIFICATION_SORT_CHILDREN);
+}
+
+void BenchmarkList::_register_methods() {
+	register_method("_notification", &BenchmarkList::_notification);
+	register_method("_get_minimum_size", &BenchmarkList::_get_minimum_size);
+}
+
+void BenchmarkList::_init() {
+	set_direction(VERTICAL);
+}
+
+Dictionary Benchmarks::run_layout_benchmarks(Node* parent, int child_count) {
+	static const int repeats = 100;
+	static const Size2 child_size{ 100, 20 };
+
+	// Minimum sizes are only tracked inside the tree
+	auto list = BenchmarkList::_new();
+	list->set_size({ 400, 0 });
+	std::vector<Control*> children;
+	children.reserve(child_count);
+	for (int i = 0; i < child_count; ++i) {
+		auto child = Control::_new();
+		child->set_custom_minimum_size(child_size);
+		list->add_child(child);
+		children.push_back(child);
+	}
+	parent->add_child(list);
+
+	Dictionary result;
+	result["children"] = child_count;
+
+	auto start = now_usec();
+	list->relayout();
+	result["first_layout_usec"] = now_usec() - start;
+
+	// Changing the separation lays out and moves every child again, which is what any change cost before the layout was cached
+	start = now_usec();
+	for (int i = 0; i < repeats; ++i) {
+		list->set_separation(2 + i % 2);
+		list->relayout();
+	}
+	result["full_relayout_usec"] = static_cast<double>(now_usec() - start) / repeats;
+
+	struct Change {
+		const char* name;
+		int idx;
+	};
+	for (auto [name, idx] : { Change{ "first", 0 }, Change{ "middle", child_count / 2 }, Change{ "last", child_count - 1 } }) {
+		if (idx < 0) {
+			continue;
+		}
+		int64_t total = 0;
+		for (int i = 0; i < repeats; ++i) {
+			auto child = children[idx];
+			child->set_custom_minimum_size({ child_size.x, i % 2 ? child_size.y : child_size.y * 2 });
+			// The engine emits this on the next idle frame, the benchmark doesn't wait for one
+			child->emit_signal("minimum_size_changed");
+
+			start = now_usec();
+			list->relayout();
+			total += now_usec() - start;
+		}
+		result[String("change_") + name + "_usec"] = static_cast<double>(total) / repeats;
+	}
+
+	parent->remove_child(list);
+	list->free();
+	return result;
+}
+
+void Benchmarks::_register_methods() {
+	register_method("run_schema_benchmarks", &Benchmarks::run_schema_benchmarks);
+	register_method("run_layout_benchmarks", &Benchmarks::run_layout_benchmarks);
+}
+
+void Benchmarks::_init() {
+}
+
+Benchmarks::Benchmarks() {
+}
+
+Benchmarks::~Benchmarks() {
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Utils.hpp"
+
+#include <Dictionary.hpp>
+#include <Godot.hpp>
+#include <Node.hpp>
+#include <Reference.hpp>
+
+namespace godot::structural_inspector {
+
+/// ListContainer that can be laid out on demand, doing what it would on the next NOTIFICATION_SORT_CHILDREN
+class BenchmarkList : public ListContainer {
+	GODOT_CLASS(BenchmarkList, ListContainer)
+protected:
+	void _notification(int what);
+	Size2 _get_minimum_size();
+
+public:
+	static void _register_methods();
+	void _init();
+
+	void relayout();
+};
+
+/// Timings of the plugin's hot paths on generated inputs, run by project/bench/run_benchmarks.gd.
+/// Only part of the library when built with `scons bench=yes`.
+class Benchmarks : public Reference {
+	GODOT_CLASS(Benchmarks, Reference)
+public:
+	static void _register_methods();
+	void _init();
+
+	/// Parses, saves, clones, compiles, validates against and frees schemas nested up to 1000 levels deep and with up to 100k nodes.
+	/// Returns `{ "cases": [...], "stack_size": ... }`, each case has the time of every step in microseconds (best of a few runs),
+	/// `ns_per_node` for all of them together, and `stack_used` in bytes (-1 where it can't be measured).
+	Dictionary run_schema_benchmarks();
+	/// Lays out a ListContainer with `child_count` children under `parent`, then again after changing the minimum size of a single child (the first, middle or last one).
+	/// Returns the time of each in microseconds, averaged over many layouts, next to the time of laying out every child again.
+	Dictionary run_layout_benchmarks(Node* parent, int child_count);
+
+	Benchmarks();
+	~Benchmarks();
+};
+
+} // namespace godot::structural_inspector
@@ -0,0 +1,30 @@
+extends SceneTree
+
+# Validates every resource whose script has a sibling .schema.tres, and exits with a non-zero code if any of them fails.
+# Usage: godot --no-window --script res://addons/structural-inspector/validate_project.gd [--report=<path>] [--threads=<n>]
+# The report (JSON) is printed to stdout, or written to <path> if given.
+
+func _init():
+	var report_path = ""
+	var validator = preload("res://addons/structural-inspector/ProjectValidator.gdns").new()
+	for arg in OS.get_cmdline_args():
+		if arg.begins_with("--report="):
+			report_path = arg.trim_prefix("--report=")
+		elif arg.begins_with("--threads="):
+			validator.thread_count = int(arg.trim_prefix("--threads="))
+
+	var report = validator.validate_project("res://")
+	var json = JSON.print(report, "\t")
+	if report_path.empty():
+		print(json)
+	else:
+		var file = File.new()
+		if file.open(report_path, File.WRITE) != OK:
+			printerr("Failed to open report file " + report_path)
+			quit(2)
+			return
+		file.store_string(json)
+		file.close()
+
+	printerr("Validated %d resources, %d failed (%d ms, %d threads)" % [report.checked, report.failed, report.elapsed_msec, report.threads])
+	quit(1 if report.failed > 0 else 0)
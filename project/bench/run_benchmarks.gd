@@ -0,0 +1,35 @@
+extends SceneTree
+
+# Runs the benchmarks in bench/ and prints their results, the library has to be built with `scons bench=yes`.
+# Usage: godot --no-window --script res://bench/run_benchmarks.gd
+
+func _initialize():
+	var benchmarks = preload("res://bench/Benchmarks.gdns").new()
+	if not benchmarks.has_method("run_schema_benchmarks"):
+		printerr("The library was built without benchmarks, rebuild it with `scons bench=yes`")
+		quit(2)
+		return
+
+	var schema = benchmarks.run_schema_benchmarks()
+	print("Schemas (microseconds, best of 3; stack of %d KiB per case)" % (schema.stack_size / 1024))
+	print("%-12s %7s %6s %8s %8s %8s %8s %8s %8s %8s %10s" % ["shape", "nodes", "depth", "parse", "save", "clone", "compile", "validate", "free", "ns/node", "stack KiB"])
+	var failed = false
+	for c in schema.cases:
+		if not c.ok or c.errors > 0:
+			printerr("%s with %d nodes failed" % [c.shape, c.nodes])
+			failed = true
+			continue
+		# The stack can't be measured on Windows
+		var stack = "n/a" if c.stack_used < 0 else "%.1f" % (c.stack_used / 1024.0)
+		print("%-12s %7d %6d %8d %8d %8d %8d %8d %8d %8.1f %10s" % [c.shape, c.nodes, c.depth, c.parse_usec, c.save_usec, c.clone_usec, c.compile_usec, c.validate_usec, c.free_usec, c.ns_per_node, stack])
+
+	var layout = benchmarks.run_layout_benchmarks(get_root(), 10000)
+	print("")
+	print("ListContainer with %d children (microseconds per layout)" % layout.children)
+	print("first layout:          %d" % layout.first_layout_usec)
+	print("every child again:     %.1f" % layout.full_relayout_usec)
+	print("after changing first:  %.1f" % layout.change_first_usec)
+	print("after changing middle: %.1f" % layout.change_middle_usec)
+	print("after changing last:   %.1f" % layout.change_last_usec)
+
+	quit(1 if failed else 0)
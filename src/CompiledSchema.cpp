@@ -0,0 +1,374 @@
+#include "CompiledSchema.hpp"
+
+#include <cstring>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+// Fingerprints are meant to be stable across runs and platforms, so they must not depend on std::hash, pointer values or type widths
+static uint64_t mix(uint64_t h, uint64_t value) {
+	// splitmix64 finalizer over the combined value
+	uint64_t x = h ^ (value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+static uint64_t hash_string(const String& string) {
+	// FNV-1a over the UTF-8 bytes, wchar_t is 16 bits on Windows and 32 bits elsewhere
+	uint64_t h = 0xCBF29CE484222325ull;
+	auto bytes = string.utf8();
+	auto data = bytes.get_data();
+	for (int i = 0; i < bytes.length(); ++i) {
+		h = (h ^ static_cast<uint8_t>(data[i])) * 0x100000001B3ull;
+	}
+	return h;
+}
+
+static uint64_t hash_real(real_t value) {
+	// Widened to double, so that builds with single and double precision real_t agree on the bounds they share
+	double wide = value;
+	// Make 0.0 and -0.0 hash the same, since they compare equal
+	if (wide == 0) {
+		wide = 0;
+	}
+	uint64_t bits;
+	std::memcpy(&bits, &wide, sizeof(bits));
+	return bits;
+}
+
+bool CompiledSchema::_equal(const SchemaNode& a, const SchemaNode& b) const {
+	if (a.fingerprint != b.fingerprint || a.kind != b.kind || a.count != b.count) {
+		return false;
+	}
+	// Children are already interned when their parent is added, so comparing their ids is enough
+	switch (a.kind) {
+		case SchemaKind::STRUCT: {
+			for (uint32_t i = 0; i < a.count; ++i) {
+				auto& field_a = fields[a.first + i];
+				auto& field_b = fields[b.first + i];
+				if (field_a.node != field_b.node || field_a.name != field_b.name) {
+					return false;
+				}
+			}
+			return true;
+		}
+		case SchemaKind::ARRAY: {
+			return a.array.min_elements == b.array.min_elements &&
+					a.array.max_elements == b.array.max_elements &&
+					fields[a.first].node == fields[b.first].node;
+		}
+		case SchemaKind::STRING: {
+			auto pattern_a = get_pattern(a);
+			auto pattern_b = get_pattern(b);
+			if (pattern_a == nullptr || pattern_b == nullptr) {
+				return pattern_a == pattern_b;
+			}
+			return pattern_a == pattern_b || pattern_a->get_source() == pattern_b->get_source();
+		}
+		case SchemaKind::ENUM: {
+			for (uint32_t i = 0; i < a.count; ++i) {
+				auto& value_a = enum_values[a.first + i];
+				auto& value_b = enum_values[b.first + i];
+				if (value_a.id != value_b.id || value_a.name != value_b.name) {
+					return false;
+				}
+			}
+			return true;
+		}
+		case SchemaKind::INT: {
+			return a.int_range.min_value == b.int_range.min_value && a.int_range.max_value == b.int_range.max_value;
+		}
+		case SchemaKind::FLOAT: {
+			return a.float_range.min_value == b.float_range.min_value && a.float_range.max_value == b.float_range.max_value;
+		}
+		case SchemaKind::BOOL: {
+			return true;
+		}
+		case SchemaKind::REF: {
+			return fields[a.first].name == fields[b.first].name;
+		}
+	}
+	return false;
+}
+
+SchemaNodeId CompiledSchema::_add_ref(const String& name) {
+	if (auto it = ref_nodes.find(name); it != ref_nodes.end()) {
+		return it->second;
+	}
+
+	SchemaNode node;
+	node.kind = SchemaKind::REF;
+	node.first = fields.size();
+	node.count = 1;
+	node.ref.recursive = false;
+	node.fingerprint = mix(mix(0, static_cast<uint64_t>(SchemaKind::REF)), hash_string(name));
+	fields.push_back({ name, NO_NODE });
+
+	auto id = static_cast<SchemaNodeId>(nodes.size());
+	nodes.push_back(node);
+	ref_nodes.insert({ name, id });
+
+	if (definition_schemas.count(name)) {
+		pending_refs.push_back(id);
+	} else {
+		ERR_PRINT("Reference to unknown schema definition '" + name + "'");
+	}
+	return id;
+}
+
+SchemaNodeId CompiledSchema::_add(const Schema& schema) {
+	// Post-order walk with an explicit stack: children are added (and interned) first, so that a node can be compared to existing ones by the ids of its children
+	struct Frame {
+		const Schema* schema;
+		bool children_pushed;
+	};
+	std::vector<Frame> stack{ { &schema, false } };
+	// Ids of finished nodes, the children of the frame on top of the stack are the last entries
+	std::vector<SchemaNodeId> results;
+
+	while (!stack.empty()) {
+		auto current = stack.back().schema;
+		uint32_t child_count = 0;
+		switch (current->kind) {
+			case SchemaKind::STRUCT: child_count = static_cast<const StructSchema*>(current)->fields.size(); break;
+			case SchemaKind::ARRAY: child_count = 1; break;
+			default: break;
+		}
+
+		if (child_count > 0 && !stack.back().children_pushed) {
+			stack.back().children_pushed = true;
+			// Reversed, so that children finish in order
+			switch (current->kind) {
+				case SchemaKind::STRUCT: {
+					auto& fields = static_cast<const StructSchema*>(current)->fields;
+					for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+						stack.push_back({ it->def.get(), false });
+					}
+				} break;
+				case SchemaKind::ARRAY: {
+					stack.push_back({ static_cast<const ArraySchema*>(current)->element_type.get(), false });
+				} break;
+				default: break;
+			}
+			continue;
+		}
+
+		auto id = _add_node(*current, results.data() + results.size() - child_count);
+		results.resize(results.size() - child_count);
+		results.push_back(id);
+		stack.pop_back();
+	}
+	return results.back();
+}
+
+SchemaNodeId CompiledSchema::_add_node(const Schema& schema, const SchemaNodeId* children) {
+	if (schema.kind == SchemaKind::REF) {
+		// References are unique per name instead of hash-consed, their target may not be compiled yet (or ever finish compiling, if it is recursive)
+		return _add_ref(static_cast<const RefSchema&>(schema).target);
+	}
+
+	// Arena sizes before this node's own payload, to roll back to if an identical node already exists
+	auto fields_size = fields.size();
+	auto enum_values_size = enum_values.size();
+	auto patterns_size = patterns.size();
+
+	SchemaNode node;
+	node.kind = schema.kind;
+	uint64_t h = mix(0, static_cast<uint64_t>(schema.kind));
+	switch (schema.kind) {
+		case SchemaKind::STRUCT: {
+			auto& stru = static_cast<const StructSchema&>(schema);
+			// Fields of a struct are contiguous
+			node.first = fields.size();
+			node.count = stru.fields.size();
+			for (uint32_t i = 0; i < node.count; ++i) {
+				auto& name = stru.fields[i].name;
+				fields.push_back({ name, children[i] });
+				h = mix(mix(h, hash_string(name)), nodes[children[i]].fingerprint);
+			}
+		} break;
+		case SchemaKind::ARRAY: {
+			auto& array = static_cast<const ArraySchema&>(schema);
+			auto element_id = children[0];
+			node.first = fields.size();
+			node.count = 1;
+			node.array.min_elements = array.min_elements;
+			node.array.max_elements = array.max_elements;
+			fields.push_back({ "", element_id });
+			h = mix(h, nodes[element_id].fingerprint);
+			h = mix(h, static_cast<uint32_t>(array.min_elements));
+			h = mix(h, static_cast<uint32_t>(array.max_elements));
+		} break;
+		case SchemaKind::STRING: {
+			auto& string = static_cast<const StringSchema&>(schema);
+			if (string.pattern) {
+				node.string.pattern = patterns.size();
+				patterns.push_back(string.pattern);
+				h = mix(h, hash_string(string.pattern->get_source()));
+			} else {
+				node.string.pattern = NO_PATTERN;
+			}
+		} break;
+		case SchemaKind::ENUM: {
+			auto& en = static_cast<const EnumSchema&>(schema);
+			node.first = enum_values.size();
+			node.count = en.elements.size();
+			enum_values.insert(enum_values.end(), en.elements.begin(), en.elements.end());
+			for (auto& element : en.elements) {
+				h = mix(mix(h, hash_string(element.name)), static_cast<uint32_t>(element.id));
+			}
+		} break;
+		case SchemaKind::INT: {
+			auto& sint = static_cast<const IntSchema&>(schema);
+			node.int_range.min_value = sint.min_value;
+			node.int_range.max_value = sint.max_value;
+			h = mix(mix(h, static_cast<uint32_t>(sint.min_value)), static_cast<uint32_t>(sint.max_value));
+		} break;
+		case SchemaKind::FLOAT: {
+			auto& sfloat = static_cast<const FloatSchema&>(schema);
+			node.float_range.min_value = sfloat.min_value;
+			node.float_range.max_value = sfloat.max_value;
+			h = mix(mix(h, hash_real(sfloat.min_value)), hash_real(sfloat.max_value));
+		} break;
+		case SchemaKind::BOOL: {
+		} break;
+		case SchemaKind::REF: {
+			// Handled by _add_ref()
+		} break;
+	}
+	node.fingerprint = mix(h, node.count);
+
+	auto [begin, end] = interned.equal_range(node.fingerprint);
+	for (auto it = begin; it != end; ++it) {
+		if (_equal(nodes[it->second], node)) {
+			// Drop the payload we just appended, the existing node already refers to an identical copy
+			fields.resize(fields_size);
+			enum_values.resize(enum_values_size);
+			patterns.resize(patterns_size);
+			++reused_count;
+			return it->second;
+		}
+	}
+
+	auto id = static_cast<SchemaNodeId>(nodes.size());
+	nodes.push_back(node);
+	interned.insert({ node.fingerprint, id });
+	return id;
+}
+
+void CompiledSchema::_mark_recursive_refs() {
+	std::vector<bool> visited;
+	std::vector<SchemaNodeId> stack;
+	for (auto& [name, ref_id] : ref_nodes) {
+		auto body = fields[nodes[ref_id].first].node;
+		if (body == NO_NODE) continue;
+
+		visited.assign(nodes.size(), false);
+		stack.assign(1, body);
+		while (!stack.empty()) {
+			auto id = stack.back();
+			stack.pop_back();
+			if (id == ref_id) {
+				nodes[ref_id].ref.recursive = true;
+				break;
+			}
+			if (id == NO_NODE || visited[id]) continue;
+			visited[id] = true;
+
+			auto& node = nodes[id];
+			switch (node.kind) {
+				case SchemaKind::STRUCT:
+				case SchemaKind::ARRAY:
+				case SchemaKind::REF: {
+					for (uint32_t i = 0; i < node.count; ++i) {
+						stack.push_back(fields[node.first + i].node);
+					}
+				} break;
+				default: break;
+			}
+		}
+	}
+}
+
+void CompiledSchema::_finish() {
+	interned = {};
+	definition_schemas = {};
+	_mark_recursive_refs();
+
+	// Root order in the unordered_map is unspecified, so combine the roots commutatively
+	fingerprint = 0;
+	for (auto& [name, id] : roots) {
+		fingerprint += mix(hash_string(name), nodes[id].fingerprint);
+	}
+	// REF nodes only hash the definition name, so account for the definition bodies here
+	for (auto& [name, id] : ref_nodes) {
+		auto body = fields[nodes[id].first].node;
+		fingerprint += mix(nodes[id].fingerprint, body == NO_NODE ? 0 : nodes[body].fingerprint);
+	}
+}
+
+CompiledSchema CompiledSchema::compile(const Schema& schema) {
+	CompiledSchema compiled;
+	compiled.roots.insert({ "", compiled._add(schema) });
+	compiled._finish();
+	return compiled;
+}
+
+CompiledSchema CompiledSchema::compile(const std::vector<StructSchema::Field>& roots) {
+	return compile(roots, {});
+}
+
+CompiledSchema CompiledSchema::compile(const std::vector<StructSchema::Field>& roots, const std::vector<StructSchema::Field>& definitions) {
+	CompiledSchema compiled;
+	for (auto& [name, def] : definitions) {
+		compiled.definition_schemas.insert({ name, def.get() });
+	}
+
+	for (auto& [name, def] : roots) {
+		compiled.roots.insert({ name, compiled._add(*def) });
+	}
+
+	// Definitions are compiled when first referenced, and may reference further definitions
+	while (!compiled.pending_refs.empty()) {
+		auto ref_id = compiled.pending_refs.back();
+		compiled.pending_refs.pop_back();
+
+		auto field_idx = compiled.nodes[ref_id].first;
+		auto body = compiled._add(*compiled.definition_schemas[compiled.fields[field_idx].name]);
+		compiled.fields[field_idx].node = body;
+	}
+
+	compiled._finish();
+	return compiled;
+}
+
+const SchemaNode* CompiledSchema::find_root(const String& name) const {
+	if (auto it = roots.find(name); it != roots.end()) {
+		return &nodes[it->second];
+	}
+	return nullptr;
+}
+
+const SchemaNode* CompiledSchema::resolve(const SchemaNode& node) const {
+	auto current = &node;
+	// Bounded, as definitions that only refer to each other (`A = B`, `B = A`) never reach an actual type
+	for (size_t i = 0; i <= ref_nodes.size(); ++i) {
+		if (current->kind != SchemaKind::REF) {
+			return current;
+		}
+		auto target = fields[current->first].node;
+		if (target == NO_NODE) {
+			return nullptr;
+		}
+		current = &nodes[target];
+	}
+	return nullptr;
+}
+
+const Pattern* CompiledSchema::get_pattern(const SchemaNode& node) const {
+	if (node.string.pattern == NO_PATTERN) {
+		return nullptr;
+	}
+	return patterns[node.string.pattern].get();
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Pattern.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+#include <Godot.hpp>
+#include <PoolArrays.hpp>
+#include <RegEx.hpp>
+#include <String.hpp>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+using SchemaNodeId = uint32_t;
+
+struct SchemaNode {
+	SchemaKind kind;
+	// Structural hash of this node and everything below it, see CompiledSchema::get_fingerprint()
+	uint64_t fingerprint = 0;
+	// STRUCT: range of fields in CompiledSchema::fields
+	// ARRAY: a single entry in CompiledSchema::fields, which is the element type
+	// ENUM: range of values in CompiledSchema::enum_values
+	// REF: a single entry in CompiledSchema::fields, with the name of the definition and its compiled body (CompiledSchema::NO_NODE if unresolved)
+	uint32_t first = 0;
+	uint32_t count = 0;
+	// Constraints stored inline, which member is active depends on `kind`
+	union {
+		struct {
+			int min_elements;
+			int max_elements;
+		} array;
+		struct {
+			int min_value;
+			int max_value;
+		} int_range;
+		struct {
+			real_t min_value;
+			real_t max_value;
+		} float_range;
+		struct {
+			// Index into CompiledSchema::patterns, or CompiledSchema::NO_PATTERN
+			uint32_t pattern;
+		} string;
+		struct {
+			// Whether the definition can reach this reference again (e.g. a tree node containing an array of tree nodes)
+			bool recursive;
+		} ref;
+	};
+};
+
+struct SchemaField {
+	String name;
+	SchemaNodeId node;
+};
+
+/// Flat, immutable representation of schemas, built once from the output of `parse_schema()`.
+/// All nodes live in a contiguous arena and refer to each other by index, so copying is a handful of bulk vector copies.
+/// Pointers to nodes stay valid for the lifetime of the CompiledSchema object.
+///
+/// Nodes are hash-consed: structurally identical subtrees (e.g. the same struct used as the element of several arrays) are stored once,
+/// so within one CompiledSchema two nodes are equal exactly when they are the same node.
+/// Every node carries a 64-bit structural fingerprint, which is stable across runs and can be compared between different CompiledSchema objects.
+///
+/// References to definitions are REF nodes, one per definition name, pointing to the definition's body.
+/// Their fingerprint only covers the name (so that recursive definitions can be hashed), the bodies are included in get_fingerprint().
+class CompiledSchema {
+public:
+	static constexpr uint32_t NO_PATTERN = std::numeric_limits<uint32_t>::max();
+	static constexpr SchemaNodeId NO_NODE = std::numeric_limits<SchemaNodeId>::max();
+
+private:
+	std::vector<SchemaNode> nodes;
+	std::vector<SchemaField> fields;
+	std::vector<EnumSchema::EnumValue> enum_values;
+	std::vector<std::shared_ptr<const Pattern>> patterns;
+	std::unordered_map<String, SchemaNodeId> roots;
+	// Definition name -> REF node
+	std::unordered_map<String, SchemaNodeId> ref_nodes;
+	// fingerprint -> nodes with that fingerprint, only used while compiling
+	std::unordered_multimap<uint64_t, SchemaNodeId> interned;
+	// Only used while compiling
+	std::unordered_map<String, const Schema*> definition_schemas;
+	// REF nodes whose definition hasn't been compiled yet, only used while compiling
+	std::vector<SchemaNodeId> pending_refs;
+	uint64_t fingerprint = 0;
+	size_t reused_count = 0;
+
+	bool _equal(const SchemaNode& a, const SchemaNode& b) const;
+	/// Adds `schema` and everything below it, returns the id of its node
+	SchemaNodeId _add(const Schema& schema);
+	/// Adds a single node, whose children were already added as `children` (in field order)
+	SchemaNodeId _add_node(const Schema& schema, const SchemaNodeId* children);
+	SchemaNodeId _add_ref(const String& name);
+	void _mark_recursive_refs();
+	/// Drops the compile-time lookup table and computes the combined fingerprint
+	void _finish();
+
+	// The binary format (see SchemaBinary.hpp) is a direct dump of the arena
+	friend PoolByteArray write_schema_binary(const CompiledSchema& schema, uint64_t source_modified_time);
+	friend std::shared_ptr<CompiledSchema> read_schema_binary(const PoolByteArray& data, uint64_t source_modified_time);
+
+public:
+	/// Compile a single schema, which will be accessible as the root with an empty name
+	static CompiledSchema compile(const Schema& schema);
+	/// Compile a set of named schemas (e.g. all properties of a ResourceSchema) into one arena
+	static CompiledSchema compile(const std::vector<StructSchema::Field>& roots);
+	/// Same as above, with RefSchema's resolved against `definitions`. Each referenced definition is compiled exactly once.
+	static CompiledSchema compile(const std::vector<StructSchema::Field>& roots, const std::vector<StructSchema::Field>& definitions);
+
+	/// Returns nullptr if there is no root named `name`
+	const SchemaNode* find_root(const String& name) const;
+	const std::unordered_map<String, SchemaNodeId>& get_roots() const { return roots; }
+
+	const SchemaNode& get_node(SchemaNodeId id) const { return nodes[id]; }
+	SchemaNodeId get_id(const SchemaNode& node) const { return static_cast<SchemaNodeId>(&node - nodes.data()); }
+	size_t get_node_count() const { return nodes.size(); }
+	/// Number of subtrees that were found to be identical to an existing node while compiling, and therefore not stored again
+	size_t get_reused_count() const { return reused_count; }
+
+	/// Combined fingerprint of all roots and their names, two schemas with the same fingerprint are (with overwhelming probability) identical.
+	/// Suitable as a "has this schema changed" key.
+	uint64_t get_fingerprint() const { return fingerprint; }
+	/// Nodes are interned, so this is structural equality for nodes from the same CompiledSchema
+	static bool same(const SchemaNode& a, const SchemaNode& b) { return &a == &b; }
+
+	/// Only valid for STRUCT nodes
+	const SchemaField& get_field(const SchemaNode& node, uint32_t i) const { return fields[node.first + i]; }
+	/// Only valid for STRUCT nodes
+	const SchemaNode& get_field_node(const SchemaNode& node, uint32_t i) const { return nodes[fields[node.first + i].node]; }
+	/// Only valid for ARRAY nodes
+	const SchemaNode& get_element_type(const SchemaNode& node) const { return nodes[fields[node.first].node]; }
+	/// Only valid for ENUM nodes
+	const EnumSchema::EnumValue& get_enum_value(const SchemaNode& node, uint32_t i) const { return enum_values[node.first + i]; }
+	/// Only valid for STRING nodes, returns nullptr if there is no pattern
+	const Pattern* get_pattern(const SchemaNode& node) const;
+	/// Only valid for REF nodes
+	const String& get_ref_name(const SchemaNode& node) const { return fields[node.first].name; }
+	/// Follows REF nodes to the definition they refer to, returns `node` itself for other kinds, and nullptr if the reference is unresolved
+	const SchemaNode* resolve(const SchemaNode& node) const;
+};
+
+} // namespace godot::structural_inspector
@@ -0,0 +1,493 @@
+#include "EditHistory.hpp"
+
+#include <ProjectSettings.hpp>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+const char* godot::structural_inspector::UNDO_MEMORY_LIMIT_SETTING = "structural_inspector/undo_memory_limit_mb";
+
+int godot::structural_inspector::get_undo_memory_limit() {
+	auto settings = ProjectSettings::get_singleton();
+	if (settings->has_setting(UNDO_MEMORY_LIMIT_SETTING)) {
+		return settings->get_setting(UNDO_MEMORY_LIMIT_SETTING);
+	}
+	return DEFAULT_UNDO_MEMORY_LIMIT;
+}
+
+/// Rough number of bytes kept alive by `value`, shared containers are counted every time they appear
+static size_t estimate_size(const Variant& value) {
+	size_t bytes = 0;
+	std::vector<Variant> pending{ value };
+	while (!pending.empty()) {
+		auto v = std::move(pending.back());
+		pending.pop_back();
+
+		bytes += sizeof(Variant);
+		switch (v.get_type()) {
+			case Variant::STRING: {
+				bytes += static_cast<String>(v).length() * sizeof(wchar_t);
+			} break;
+			case Variant::ARRAY: {
+				const Array array = v;
+				for (int i = 0; i < array.size(); ++i) {
+					pending.push_back(array[i]);
+				}
+			} break;
+			case Variant::DICTIONARY: {
+				const Dictionary dict = v;
+				Array keys = dict.keys();
+				for (int i = 0; i < keys.size(); ++i) {
+					pending.push_back(keys[i]);
+					pending.push_back(dict[keys[i]]);
+				}
+			} break;
+			default: break;
+		}
+	}
+	return bytes;
+}
+
+/// The element `key` of a dictionary or array, or nil if there is none
+static Variant get_element(const Variant& container, const Variant& key) {
+	switch (container.get_type()) {
+		case Variant::DICTIONARY: {
+			const Dictionary dict = container;
+			if (dict.has(key)) {
+				return dict[key];
+			}
+		} break;
+		case Variant::ARRAY: {
+			const Array array = container;
+			if (key.get_type() == Variant::INT && static_cast<int>(key) >= 0 && static_cast<int>(key) < array.size()) {
+				return array[key];
+			}
+		} break;
+		default: break;
+	}
+	return Variant{};
+}
+
+static bool is_container(const Variant& value) {
+	return value.get_type() == Variant::DICTIONARY || value.get_type() == Variant::ARRAY;
+}
+
+/// Finds the dictionary or array holding the last element of `path`, without modifying anything
+static bool resolve_container(const Variant& root, const Array& path, Variant& container) {
+	container = root;
+	for (int i = 0; i < path.size() - 1; ++i) {
+		if (!is_container(container)) {
+			return false;
+		}
+		container = get_element(container, path[i]);
+	}
+	return is_container(container);
+}
+
+/// Whether `a` and `b` are the same dictionary or array, not just equal ones
+static bool is_same_container(const Variant& a, const Variant& b) {
+	if (a.get_type() != b.get_type()) {
+		return false;
+	}
+	switch (a.get_type()) {
+		// Dictionaries compare by reference
+		case Variant::DICTIONARY: return a == b;
+		case Variant::ARRAY: {
+			// Arrays compare by their elements, so check whether growing one grows the other
+			Array x = a;
+			const Array y = b;
+			if (x.size() != y.size()) {
+				return false;
+			}
+			x.append(Variant{});
+			bool same = y.size() == x.size();
+			x.pop_back();
+			return same;
+		}
+		default: return false;
+	}
+}
+
+/// The dictionaries and arrays in `root` that `deltas` go through, at the same index for the same place in every value; nil where there is none
+static std::vector<Variant> get_touched_containers(const Variant& root, const std::vector<EditDelta>& deltas) {
+	std::vector<Variant> result;
+	for (auto& delta : deltas) {
+		// Setting the whole property doesn't modify the old value
+		if (delta.path.empty()) {
+			continue;
+		}
+		result.push_back(root);
+		Variant container = root;
+		for (int i = 0; i < delta.path.size() - 1; ++i) {
+			container = is_container(container) ? get_element(container, delta.path[i]) : Variant{};
+			result.push_back(container);
+		}
+	}
+	return result;
+}
+
+/// Whether `idx` is a valid index for `kind` in an array of `size` elements
+static bool is_valid_index(EditDelta::Kind kind, const Variant& idx, int size) {
+	if (idx.get_type() != Variant::INT) {
+		return false;
+	}
+	int i = idx;
+	// Inserting is also allowed at the end
+	return i >= 0 && (kind == EditDelta::INSERT ? i <= size : i < size);
+}
+
+/// Fills `undo` with the delta that reverts `delta` on the current value, returns false if `delta` doesn't apply to it
+static bool make_undo(const Variant& container, const EditDelta& delta, EditDelta& undo) {
+	const Variant& key = delta.path[delta.path.size() - 1];
+	undo.path = delta.path;
+	switch (container.get_type()) {
+		case Variant::DICTIONARY: {
+			if (delta.kind != EditDelta::SET) {
+				return false;
+			}
+			const Dictionary dict = container;
+			if (dict.has(key)) {
+				undo.kind = EditDelta::SET;
+				undo.value = dict[key];
+			} else {
+				undo.kind = EditDelta::ERASE;
+			}
+		} break;
+		case Variant::ARRAY: {
+			const Array array = container;
+			if (!is_valid_index(delta.kind, key, array.size())) {
+				return false;
+			}
+			switch (delta.kind) {
+				case EditDelta::SET: {
+					undo.kind = EditDelta::SET;
+					undo.value = array[key];
+				} break;
+				case EditDelta::INSERT: {
+					undo.kind = EditDelta::REMOVE;
+				} break;
+				case EditDelta::REMOVE: {
+					undo.kind = EditDelta::INSERT;
+					undo.value = array[key];
+				} break;
+				case EditDelta::MOVE: {
+					if (delta.to < 0 || delta.to >= array.size()) {
+						return false;
+					}
+					undo.kind = EditDelta::MOVE;
+					undo.path = delta.path.duplicate();
+					undo.path[undo.path.size() - 1] = delta.to;
+					undo.to = key;
+				} break;
+				default: return false;
+			}
+		} break;
+		default: return false;
+	}
+	return true;
+}
+
+/// Modifies the containers inside `root` in place
+static bool apply_delta(const Variant& root, const EditDelta& delta) {
+	Variant container;
+	if (!resolve_container(root, delta.path, container)) {
+		return false;
+	}
+
+	const Variant& key = delta.path[delta.path.size() - 1];
+	switch (container.get_type()) {
+		case Variant::DICTIONARY: {
+			// Shares its data with the property's value
+			Dictionary dict = container;
+			switch (delta.kind) {
+				case EditDelta::SET: {
+					dict[key] = delta.value;
+				} break;
+				case EditDelta::ERASE: {
+					dict.erase(key);
+				} break;
+				default: return false;
+			}
+		} break;
+		case Variant::ARRAY: {
+			Array array = container;
+			if (!is_valid_index(delta.kind, key, array.size())) {
+				return false;
+			}
+			int idx = key;
+			switch (delta.kind) {
+				case EditDelta::SET: {
+					array[idx] = delta.value;
+				} break;
+				case EditDelta::INSERT: {
+					array.insert(idx, delta.value);
+				} break;
+				case EditDelta::REMOVE: {
+					array.remove(idx);
+				} break;
+				case EditDelta::MOVE: {
+					if (delta.to < 0 || delta.to >= array.size()) {
+						return false;
+					}
+					Variant moved = array[idx];
+					array.remove(idx);
+					array.insert(delta.to, moved);
+				} break;
+				default: return false;
+			}
+		} break;
+		default: return false;
+	}
+	return true;
+}
+
+/// Deep copy of dictionaries and arrays, other values are returned as is
+static Variant duplicate_value(const Variant& value) {
+	switch (value.get_type()) {
+		case Variant::DICTIONARY: return static_cast<Dictionary>(value).duplicate(true);
+		case Variant::ARRAY: return static_cast<Array>(value).duplicate(true);
+		default: return value;
+	}
+}
+
+/// The value to set the property to for `delta`, a SET of the whole property.
+/// When more deltas follow it they modify the value in place, so they get a copy instead of the one stored in the history to be set again on redo.
+static Variant get_root_value(const std::vector<EditDelta>& deltas, const EditDelta& delta) {
+	return &delta == &deltas.back() ? delta.value : duplicate_value(delta.value);
+}
+
+/// Sets the property to `value` after its containers were modified in place, so that setters, `_set()` and the `changed` signal of resources run.
+/// Returns false if the object doesn't give the same value back, e.g. because its getter returns a copy, which the in place edits never reached.
+static bool write_back(Object* object, const String& property, const Variant& value) {
+	object->set(property, value);
+	auto stored = object->get(property);
+	return is_container(value) ? is_same_container(stored, value) : stored == value;
+}
+
+/// e.g. `contents[3].name`, in the same format as validation errors
+static String format_delta_path(const String& property, const Array& path) {
+	String result = property;
+	for (int i = 0; i < path.size(); ++i) {
+		if (path[i].get_type() == Variant::INT) {
+			result += "[" + String::num_int64(path[i]) + "]";
+		} else {
+			result += "." + static_cast<String>(path[i]);
+		}
+	}
+	return result;
+}
+
+int64_t EditHistory::_store(std::vector<EditDelta> deltas, int64_t action) {
+	auto id = next_id++;
+	size_t bytes = 0;
+	for (auto& delta : deltas) {
+		bytes += estimate_size(delta.value) + estimate_size(delta.path);
+	}
+	entries[id] = Entry{ std::move(deltas), bytes, action };
+	order.push_back(id);
+	total_bytes += bytes;
+	return id;
+}
+
+void EditHistory::_evict() {
+	size_t limit = static_cast<size_t>(std::max(get_undo_memory_limit(), 0)) * 1024 * 1024;
+	// Whole actions are dropped, oldest first, and the last one stays undoable no matter how large it is.
+	// Entries of actions that UndoRedo merged into a later one are not referenced anymore, but are only dropped here
+	while (total_bytes > limit && !order.empty()) {
+		auto action = entries[order.front()].action;
+		if (action == next_action - 1) {
+			break;
+		}
+		// The entries of an action are stored one after the other
+		while (!order.empty() && entries[order.front()].action == action) {
+			auto it = entries.find(order.front());
+			order.pop_front();
+			total_bytes -= it->second.bytes;
+			entries.erase(it);
+			++evicted;
+		}
+	}
+}
+
+void EditHistory::_apply(Object* object, String property, int64_t id) {
+	if (skip_apply) {
+		return;
+	}
+
+	auto it = entries.find(id);
+	if (it == entries.end()) {
+		ERR_PRINT(String("The edit is too old to be undone, see the ") + UNDO_MEMORY_LIMIT_SETTING + " project setting");
+		return;
+	}
+
+	Array paths;
+	Array kinds;
+	auto value = object->get(property);
+	auto& deltas = it->second.deltas;
+	for (auto& delta : deltas) {
+		if (delta.path.empty()) {
+			value = get_root_value(deltas, delta);
+		} else if (!apply_delta(value, delta)) {
+			ERR_PRINT("The edit doesn't match the current value of " + property + ", it was probably changed outside of the inspector");
+			break;
+		}
+		paths.append(delta.path);
+		kinds.append(static_cast<int>(delta.kind));
+	}
+	if (!write_back(object, property, value)) {
+		ERR_PRINT("The value of " + property + " was changed by its setter, the edit may not have been applied as is");
+	}
+	emit_signal("deltas_applied", object, property, paths, kinds);
+}
+
+void EditHistory::_register_methods() {
+	register_method("_apply", &EditHistory::_apply);
+	register_method("get_stats", &EditHistory::get_stats);
+
+	register_signal<EditHistory>("deltas_applied", Dictionary{});
+}
+
+void EditHistory::_init() {
+}
+
+void EditHistory::_custom_init(UndoRedo* undo_redo) {
+	this->undo_redo = undo_redo;
+}
+
+bool EditHistory::_apply_now(Object* object, const String& property, const std::vector<EditDelta>& deltas, std::vector<EditDelta>& undos) {
+	// Each undo is made against the value left by the deltas before it
+	undos.clear();
+	undos.reserve(deltas.size());
+	auto value = object->get(property);
+	for (auto& delta : deltas) {
+		EditDelta undo{ delta.kind, delta.path };
+		bool applied;
+		if (delta.path.empty()) {
+			// The property itself is being set, e.g. a string at the root of the schema
+			applied = delta.kind == EditDelta::SET;
+			if (applied) {
+				undo.value = value;
+				value = get_root_value(deltas, delta);
+			}
+		} else {
+			Variant container;
+			applied = resolve_container(value, delta.path, container) && make_undo(container, delta, undo) && apply_delta(value, delta);
+		}
+
+		if (!applied) {
+			std::reverse(undos.begin(), undos.end());
+			_revert(object, property, value, undos);
+			return false;
+		}
+		undos.push_back(std::move(undo));
+	}
+	std::reverse(undos.begin(), undos.end());
+
+	if (!write_back(object, property, value)) {
+		_revert(object, property, value, undos);
+		return false;
+	}
+	return true;
+}
+
+void EditHistory::_revert(Object* object, const String& property, Variant value, const std::vector<EditDelta>& undos) {
+	for (auto& undo : undos) {
+		if (undo.path.empty()) {
+			value = undo.value;
+		} else {
+			apply_delta(value, undo);
+		}
+	}
+	object->set(property, value);
+}
+
+bool EditHistory::commit(const std::vector<Object*>& objects, const String& property, const std::vector<EditDelta>& deltas) {
+	if (deltas.empty() || objects.empty()) {
+		return true;
+	}
+
+	// Objects may share their value or parts of it, e.g. the default inspector assigns the same dictionary to every node of a multi-selection.
+	// The deltas would be applied to it once per object then, so the later ones first replace their value with a copy
+	std::vector<std::vector<Variant>> touched(objects.size());
+	std::vector<bool> shared(objects.size(), false);
+	for (size_t i = 0; i < objects.size(); ++i) {
+		touched[i] = get_touched_containers(objects[i]->get(property), deltas);
+		for (size_t j = 0; j < i && !shared[i]; ++j) {
+			for (size_t k = 0; k < touched[i].size(); ++k) {
+				if (is_same_container(touched[i][k], touched[j][k])) {
+					shared[i] = true;
+					break;
+				}
+			}
+		}
+	}
+	touched.clear();
+
+	// The deltas are applied here instead of by commit_action(), which needs the undos to be known already
+	std::vector<std::vector<EditDelta>> dos(objects.size());
+	std::vector<std::vector<EditDelta>> undos(objects.size());
+	for (size_t i = 0; i < objects.size(); ++i) {
+		dos[i] = deltas;
+		if (i > 0) {
+			for (auto& delta : dos[i]) {
+				delta.value = duplicate_value(delta.value);
+			}
+		}
+		if (shared[i]) {
+			dos[i].insert(dos[i].begin(), EditDelta{ EditDelta::SET, Array{}, duplicate_value(objects[i]->get(property)) });
+		}
+		if (!_apply_now(objects[i], property, dos[i], undos[i])) {
+			for (size_t j = i; j-- > 0;) {
+				_revert(objects[j], property, objects[j]->get(property), undos[j]);
+			}
+			return false;
+		}
+	}
+
+	auto& first = deltas.front();
+	String name;
+	auto merge = UndoRedo::MERGE_DISABLE;
+	if (deltas.size() == 1 && first.kind == EditDelta::SET) {
+		// Repeated sets of the same value (e.g. typing) are merged into one action by UndoRedo, which keeps the first undo and the last do
+		name = "Set " + format_delta_path(property, first.path);
+		merge = UndoRedo::MERGE_ENDS;
+	} else if (deltas.size() == 1) {
+		name = "Edit " + format_delta_path(property, first.path);
+	} else {
+		name = "Edit " + String::num_int64(deltas.size()) + " values in " + property;
+	}
+	if (objects.size() > 1) {
+		name += " on " + String::num_int64(objects.size()) + " objects";
+	}
+	auto action = next_action++;
+	undo_redo->create_action(name, merge);
+	for (size_t i = 0; i < objects.size(); ++i) {
+		auto do_id = _store(std::move(dos[i]), action);
+		auto undo_id = _store(std::move(undos[i]), action);
+		undo_redo->add_do_method(this, "_apply", objects[i], property, do_id);
+		undo_redo->add_undo_method(this, "_apply", objects[i], property, undo_id);
+	}
+	skip_apply = true;
+	undo_redo->commit_action();
+	skip_apply = false;
+
+	_evict();
+	return true;
+}
+
+Dictionary EditHistory::get_stats() {
+	Dictionary stats;
+	stats["entries"] = static_cast<int64_t>(entries.size());
+	stats["bytes"] = static_cast<int64_t>(total_bytes);
+	stats["evicted"] = evicted;
+	return stats;
+}
+
+EditHistory::EditHistory() {
+}
+
+EditHistory::~EditHistory() {
+}
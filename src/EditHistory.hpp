@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Array.hpp>
+#include <Godot.hpp>
+#include <Reference.hpp>
+#include <String.hpp>
+#include <UndoRedo.hpp>
+#include <Variant.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+/// A change to one place inside a property's value, addressed by the dictionary keys and array indices leading to it
+struct EditDelta {
+	enum Kind {
+		// Set `path` to `value`
+		SET,
+		// Remove the dictionary key `path`, only used to undo a SET that added it
+		ERASE,
+		// Insert `value` into an array before the index `path` ends with
+		INSERT,
+		// Remove the array element `path`
+		REMOVE,
+		// Move the array element `path` to the index `to`, counted after it was taken out
+		MOVE,
+	};
+
+	Kind kind;
+	// Never empty except for a SET of the whole property
+	Array path;
+	Variant value;
+	int64_t to = 0;
+};
+
+/// Project setting for how many megabytes of values the edit history may keep, the oldest edits can't be undone once it is full
+extern const char* UNDO_MEMORY_LIMIT_SETTING;
+static constexpr int DEFAULT_UNDO_MEMORY_LIMIT = 64;
+int get_undo_memory_limit();
+
+/// Undo/redo for the structural inspector that stores what changed instead of copies of the whole property.
+/// Deltas are kept here and the editor's UndoRedo only refers to them by id, so that the memory they use can be capped.
+/// Applying deltas modifies the dictionaries and arrays of the property in place and then sets the property to them, and emits "deltas_applied" for the inspector properties to update.
+class EditHistory : public Reference {
+	GODOT_CLASS(EditHistory, Reference)
+private:
+	struct Entry {
+		// Applied in order as one step
+		std::vector<EditDelta> deltas;
+		size_t bytes;
+		// The commit() this entry was stored by, an action keeps a do and an undo entry per object
+		int64_t action;
+	};
+
+	UndoRedo* undo_redo = nullptr;
+	std::unordered_map<int64_t, Entry> entries;
+	// Oldest first
+	std::deque<int64_t> order;
+	int64_t next_id = 0;
+	int64_t next_action = 0;
+	size_t total_bytes = 0;
+	int64_t evicted = 0;
+	// Set while UndoRedo runs the do method of an action whose deltas commit() already applied
+	bool skip_apply = false;
+
+	int64_t _store(std::vector<EditDelta> deltas, int64_t action);
+	/// Applies `deltas` right away and fills `undos` with the deltas reverting them in order.
+	/// Leaves the value unchanged and returns false if one of them doesn't apply, or the object doesn't keep the result.
+	bool _apply_now(Object* object, const String& property, const std::vector<EditDelta>& deltas, std::vector<EditDelta>& undos);
+	/// Applies `undos` to `value`, and sets the property to the result
+	void _revert(Object* object, const String& property, Variant value, const std::vector<EditDelta>& undos);
+	void _evict();
+	void _apply(Object* object, String property, int64_t id);
+
+public:
+	static void _register_methods();
+	void _init();
+	void _custom_init(UndoRedo* undo_redo);
+
+	/// Applies `deltas` in order to `object[property]` of every object as a single undoable action, returns false without changing anything if one of them doesn't apply.
+	/// Each object after the first gets its own copy of the values, so that the objects never share dictionaries or arrays.
+	/// Objects whose value shares a container the deltas go through with an earlier object's (e.g. after duplicating a node) are first given a copy of their value, as part of the same action.
+	bool commit(const std::vector<Object*>& objects, const String& property, const std::vector<EditDelta>& deltas);
+
+	/// `{ "entries": ..., "bytes": ..., "evicted": ... }`
+	Dictionary get_stats();
+
+	EditHistory();
+	~EditHistory();
+};
+
+} // namespace godot::structural_inspector
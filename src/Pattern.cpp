@@ -0,0 +1,75 @@
+#include "Pattern.hpp"
+
+#include <algorithm>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+Pattern::Pattern(const String& source, Ref<RegEx> regex) :
+		source{ source },
+		regex{ regex },
+		prefilter{ PatternPrefilter::analyse(source.unicode_str(), source.length()) } {
+}
+
+bool Pattern::matches(const String& value) const {
+	switch (prefilter.check(value.unicode_str(), value.length())) {
+		case PatternPrefilter::NO_MATCH: return false;
+		case PatternPrefilter::MATCH: return true;
+		case PatternPrefilter::UNKNOWN: break;
+	}
+	return regex->search(value).is_valid();
+}
+
+void PatternCache::_remove_expired() {
+	for (auto it = patterns.begin(); it != patterns.end();) {
+		if (it->second.expired()) {
+			it = patterns.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+PatternCache& PatternCache::get_singleton() {
+	static PatternCache instance;
+	return instance;
+}
+
+std::shared_ptr<const Pattern> PatternCache::intern(const String& source) {
+	std::lock_guard<std::mutex> lock{ mutex };
+	if (auto it = patterns.find(source); it != patterns.end()) {
+		if (auto pattern = it->second.lock()) {
+			++hits;
+			return pattern;
+		}
+	}
+	++misses;
+
+	auto regex = Ref{ RegEx::_new() };
+	if (regex->compile(source) != Error::OK) {
+		return nullptr;
+	}
+
+	auto pattern = std::make_shared<const Pattern>(source, regex);
+	patterns[source] = pattern;
+
+	// Amortized cleanup, so that the table stays proportional to the number of live patterns
+	if (patterns.size() >= next_cleanup) {
+		_remove_expired();
+		next_cleanup = std::max<size_t>(64, patterns.size() * 2);
+	}
+	return pattern;
+}
+
+size_t PatternCache::get_size() {
+	std::lock_guard<std::mutex> lock{ mutex };
+	return patterns.size();
+}
+
+Dictionary PatternCache::get_stats() {
+	Dictionary stats;
+	stats["hits"] = static_cast<int64_t>(get_hits());
+	stats["misses"] = static_cast<int64_t>(get_misses());
+	stats["size"] = static_cast<int64_t>(get_size());
+	return stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "PatternPrefilter.hpp"
+#include "Utils.hpp"
+
+#include <Godot.hpp>
+#include <RegEx.hpp>
+#include <String.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace godot::structural_inspector {
+
+/// Compiled, immutable string pattern. Instances are interned by PatternCache, so every schema using the same pattern shares one.
+class Pattern {
+private:
+	String source;
+	Ref<RegEx> regex;
+	PatternPrefilter prefilter;
+
+public:
+	Pattern(const String& source, Ref<RegEx> regex);
+
+	const String& get_source() const { return source; }
+	const Ref<RegEx>& get_regex() const { return regex; }
+
+	/// Whether the literal/anchored fast paths can decide (some) values without running the regex
+	bool has_prefilter() const { return prefilter.is_supported(); }
+
+	/// Tries the prefilter first, and only falls back to the regex engine when it can't decide
+	bool matches(const String& value) const;
+};
+
+/// Process-wide, thread-safe `pattern source -> compiled Pattern` intern table.
+/// Entries are held weakly, patterns no schema uses anymore (e.g. the intermediate states of typing a pattern into the schema editor) are not kept alive.
+class PatternCache {
+private:
+	std::mutex mutex;
+	std::unordered_map<String, std::weak_ptr<const Pattern>> patterns;
+	size_t next_cleanup = 64;
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> misses{ 0 };
+
+	void _remove_expired();
+
+public:
+	static PatternCache& get_singleton();
+
+	/// Returns nullptr if `source` fails to compile
+	std::shared_ptr<const Pattern> intern(const String& source);
+
+	uint64_t get_hits() const { return hits; }
+	uint64_t get_misses() const { return misses; }
+	size_t get_size();
+	/// `{ "hits": int, "misses": int, "size": int }`
+	Dictionary get_stats();
+};
+
+} // namespace godot::structural_inspector
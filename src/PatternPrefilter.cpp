@@ -0,0 +1,429 @@
+#include "PatternPrefilter.hpp"
+
+#include <algorithm>
+
+using namespace godot::structural_inspector;
+
+// Avoid overflowing the length computations on silly repeat counts
+static const int MAX_REPEAT = 1 << 20;
+
+void PatternPrefilter::CharSet::add_range(uint32_t from, uint32_t to) {
+	for (uint32_t c = from; c <= to; ++c) {
+		add(c);
+	}
+}
+
+void PatternPrefilter::CharSet::invert() {
+	for (auto& word : bits) {
+		word = ~word;
+	}
+	others = !others;
+}
+
+int PatternPrefilter::CharSet::single_char() const {
+	if (others) {
+		return -1;
+	}
+	int found = -1;
+	for (int i = 0; i < 4; ++i) {
+		auto word = bits[i];
+		if (word == 0) continue;
+		// More than one bit set, or a bit already found in a previous word
+		if ((word & (word - 1)) != 0 || found != -1) {
+			return -1;
+		}
+		int bit = 0;
+		while (!((word >> bit) & 1)) {
+			++bit;
+		}
+		found = i * 64 + bit;
+	}
+	return found;
+}
+
+static bool is_digit(wchar_t c) {
+	return c >= '0' && c <= '9';
+}
+
+static bool is_alnum(wchar_t c) {
+	return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/// Characters for which PCRE's behavior around `.` and `$` depends on its newline configuration, we don't try to decide values containing them
+static bool is_newline_like(wchar_t c) {
+	return c == '\n' || c == '\r' || c == 0x0B || c == 0x0C || c == 0x85 || c == 0x2028 || c == 0x2029;
+}
+
+// \d \w \s are ASCII only, like PCRE without the UCP option
+bool PatternPrefilter::CharSet::add_class_escape(wchar_t escape) {
+	CharSet escape_set;
+	switch (escape) {
+		case 'd':
+		case 'D': {
+			escape_set.add_range('0', '9');
+		} break;
+		case 'w':
+		case 'W': {
+			escape_set.add_range('a', 'z');
+			escape_set.add_range('A', 'Z');
+			escape_set.add_range('0', '9');
+			escape_set.add('_');
+		} break;
+		case 's':
+		case 'S': {
+			escape_set.add(' ');
+			escape_set.add_range(0x09, 0x0D);
+		} break;
+		default: return false;
+	}
+	if (escape == 'D' || escape == 'W' || escape == 'S') {
+		escape_set.invert();
+	}
+	for (int i = 0; i < 4; ++i) {
+		bits[i] |= escape_set.bits[i];
+	}
+	others = others || escape_set.others;
+	return true;
+}
+
+/// Returns the literal character for escapes like `\.` or `\n`, or -1 if the escape is not a literal (or not supported)
+static int literal_escape(wchar_t escape) {
+	switch (escape) {
+		case 'n': return '\n';
+		case 't': return '\t';
+		case 'r': return '\r';
+		case 'f': return '\f';
+		default: break;
+	}
+	// Escaped punctuation always means the character itself
+	if (escape < 128 && !is_alnum(escape) && escape > ' ') {
+		return escape;
+	}
+	return -1;
+}
+
+bool PatternPrefilter::_parse(const wchar_t* source, int length) {
+	int i = 0;
+	if (i < length && source[i] == '^') {
+		anchored_start = true;
+		++i;
+	}
+
+	int end = length;
+	if (end > i && source[end - 1] == '$') {
+		// Make sure the `$` isn't escaped
+		int backslashes = 0;
+		for (int j = end - 2; j >= i && source[j] == '\\'; --j) {
+			++backslashes;
+		}
+		if (backslashes % 2 == 0) {
+			anchored_end = true;
+			--end;
+		}
+	}
+
+	while (i < end) {
+		Atom atom;
+		wchar_t c = source[i];
+		switch (c) {
+			case '.': {
+				atom.set.invert();
+				// Newline-like characters are rejected before reaching the set, see is_newline_like()
+				++i;
+			} break;
+
+			case '\\': {
+				if (i + 1 >= end) return false;
+				wchar_t escape = source[i + 1];
+				if (!atom.set.add_class_escape(escape)) {
+					int literal = literal_escape(escape);
+					if (literal == -1) return false;
+					atom.set.add(literal);
+				}
+				i += 2;
+			} break;
+
+			case '[': {
+				int j = i + 1;
+				bool negate = false;
+				if (j < end && source[j] == '^') {
+					negate = true;
+					++j;
+				}
+
+				bool first = true;
+				while (true) {
+					if (j >= end) return false;
+					wchar_t ch = source[j];
+					if (ch == ']' && !first) {
+						break;
+					}
+					first = false;
+
+					int low;
+					if (ch == '\\') {
+						if (j + 1 >= end) return false;
+						wchar_t escape = source[j + 1];
+						j += 2;
+						if (atom.set.add_class_escape(escape)) {
+							continue;
+						}
+						low = literal_escape(escape);
+						if (low == -1) return false;
+					} else if (ch == '[' && j + 1 < end && (source[j + 1] == ':' || source[j + 1] == '.' || source[j + 1] == '=')) {
+						// POSIX classes and collating elements
+						return false;
+					} else if (ch >= 256) {
+						return false;
+					} else {
+						low = ch;
+						++j;
+					}
+
+					if (j + 1 < end && source[j] == '-' && source[j + 1] != ']') {
+						wchar_t high_ch = source[j + 1];
+						int high;
+						if (high_ch == '\\') {
+							if (j + 2 >= end) return false;
+							high = literal_escape(source[j + 2]);
+							if (high == -1) return false;
+							j += 3;
+						} else if (high_ch == '[' || high_ch >= 256) {
+							return false;
+						} else {
+							high = high_ch;
+							j += 2;
+						}
+						if (low > high) return false;
+						atom.set.add_range(low, high);
+					} else {
+						atom.set.add(low);
+					}
+				}
+
+				if (negate) {
+					atom.set.invert();
+				}
+				i = j + 1;
+			} break;
+
+			case '(':
+			case ')':
+			case '|':
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+			case '}':
+			case ']':
+			case '^':
+			case '$': {
+				return false;
+			}
+
+			default: {
+				if (c >= 256) return false;
+				atom.set.add(c);
+				++i;
+			} break;
+		}
+
+		atom.min = 1;
+		atom.max = 1;
+		if (i < end) {
+			switch (source[i]) {
+				case '*': {
+					atom.min = 0;
+					atom.max = -1;
+					++i;
+				} break;
+				case '+': {
+					atom.min = 1;
+					atom.max = -1;
+					++i;
+				} break;
+				case '?': {
+					atom.min = 0;
+					atom.max = 1;
+					++i;
+				} break;
+				case '{': {
+					int j = i + 1;
+					auto read_number = [&](int& out) {
+						int start = j;
+						out = 0;
+						while (j < end && is_digit(source[j])) {
+							out = std::min(out * 10 + (source[j] - '0'), MAX_REPEAT);
+							++j;
+						}
+						return j > start;
+					};
+
+					if (!read_number(atom.min)) return false;
+					if (j < end && source[j] == ',') {
+						++j;
+						if (!read_number(atom.max)) {
+							atom.max = -1;
+						}
+					} else {
+						atom.max = atom.min;
+					}
+					if (j >= end || source[j] != '}') return false;
+					if (atom.max != -1 && atom.min > atom.max) return false;
+					i = j + 1;
+				} break;
+				default: break;
+			}
+			if (i < end && atom.max != atom.min) {
+				// Lazy quantifiers match the same set of strings, possessive ones don't
+				if (source[i] == '?') {
+					++i;
+				} else if (source[i] == '+') {
+					return false;
+				}
+			}
+		}
+
+		atoms.push_back(atom);
+	}
+	return true;
+}
+
+PatternPrefilter PatternPrefilter::analyse(const wchar_t* source, int length) {
+	PatternPrefilter result;
+	if (!result._parse(source, length)) {
+		return PatternPrefilter{};
+	}
+	result.supported = true;
+
+	result.literal = true;
+	for (int i = 0; i < static_cast<int>(result.atoms.size()); ++i) {
+		auto& atom = result.atoms[i];
+		result.min_length = std::min(result.min_length + atom.min, MAX_REPEAT);
+		if (atom.min != atom.max) {
+			result.variable_atom = result.variable_atom == -1 ? i : -2;
+		}
+		if (atom.min != atom.max || atom.set.single_char() == -1) {
+			result.literal = false;
+		}
+	}
+
+	if (result.anchored_start || result.literal) {
+		for (auto& atom : result.atoms) {
+			int c = atom.set.single_char();
+			if (c == -1 || atom.min != atom.max) break;
+			result.prefix.append(atom.min, static_cast<char>(c));
+		}
+	}
+	if (result.anchored_end) {
+		for (auto it = result.atoms.rbegin(); it != result.atoms.rend(); ++it) {
+			int c = it->set.single_char();
+			if (c == -1 || it->min != it->max) break;
+			result.suffix.insert(result.suffix.begin(), it->min, static_cast<char>(c));
+		}
+	}
+	return result;
+}
+
+PatternPrefilter::Result PatternPrefilter::_match_exact(const wchar_t* value, int length) const {
+	for (int i = 0; i < length; ++i) {
+		if (is_newline_like(value[i])) {
+			return UNKNOWN;
+		}
+		// Godot strings are UTF-16 on platforms with a 16-bit wchar_t, while PCRE counts code points
+		if (sizeof(wchar_t) == 2 && value[i] >= 0xD800 && value[i] <= 0xDFFF) {
+			return UNKNOWN;
+		}
+	}
+
+	int atom_count = atoms.size();
+	int head_end = variable_atom == -1 ? atom_count : variable_atom;
+
+	int pos = 0;
+	for (int i = 0; i < head_end; ++i) {
+		auto& atom = atoms[i];
+		for (int k = 0; k < atom.min; ++k, ++pos) {
+			if (pos >= length || !atom.set.has(value[pos])) {
+				return NO_MATCH;
+			}
+		}
+	}
+	if (variable_atom == -1) {
+		return pos == length ? MATCH : NO_MATCH;
+	}
+
+	int tail = length;
+	for (int i = atom_count - 1; i > variable_atom; --i) {
+		auto& atom = atoms[i];
+		for (int k = 0; k < atom.min; ++k) {
+			--tail;
+			if (tail < pos || !atom.set.has(value[tail])) {
+				return NO_MATCH;
+			}
+		}
+	}
+
+	auto& middle = atoms[variable_atom];
+	int count = tail - pos;
+	if (count < middle.min || (middle.max != -1 && count > middle.max)) {
+		return NO_MATCH;
+	}
+	for (int i = pos; i < tail; ++i) {
+		if (!middle.set.has(value[i])) {
+			return NO_MATCH;
+		}
+	}
+	return MATCH;
+}
+
+PatternPrefilter::Result PatternPrefilter::check(const wchar_t* value, int length) const {
+	if (!supported) {
+		return UNKNOWN;
+	}
+
+	// Lengths are in code units, which is never less than the number of code points, so this is safe for UTF-16 too
+	if (length < min_length) {
+		return NO_MATCH;
+	}
+
+	int prefix_length = prefix.size();
+	if (anchored_start && prefix_length > 0) {
+		for (int i = 0; i < prefix_length; ++i) {
+			if (value[i] != static_cast<unsigned char>(prefix[i])) {
+				return NO_MATCH;
+			}
+		}
+	}
+
+	// `$` also matches before a trailing newline
+	bool trailing_newline = length > 0 && is_newline_like(value[length - 1]);
+	int suffix_length = suffix.size();
+	if (anchored_end && suffix_length > 0 && !trailing_newline) {
+		for (int i = 0; i < suffix_length; ++i) {
+			if (value[length - suffix_length + i] != static_cast<unsigned char>(suffix[i])) {
+				return NO_MATCH;
+			}
+		}
+	}
+
+	if (literal) {
+		if (anchored_start && anchored_end) {
+			if (trailing_newline) return UNKNOWN;
+			return length == prefix_length ? MATCH : NO_MATCH;
+		} else if (anchored_start) {
+			return MATCH;
+		} else if (anchored_end) {
+			return trailing_newline ? UNKNOWN : MATCH;
+		} else {
+			auto found = std::search(value, value + length, prefix.begin(), prefix.end(), [](wchar_t a, char b) {
+				return a == static_cast<unsigned char>(b);
+			});
+			return found != value + length || prefix_length == 0 ? MATCH : NO_MATCH;
+		}
+	}
+
+	if (anchored_start && anchored_end && variable_atom != -2) {
+		return _match_exact(value, length);
+	}
+	return UNKNOWN;
+}
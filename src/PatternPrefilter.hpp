@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+/// Cheap checks derived once from a regex source, used to avoid running the full regex engine for common simple patterns.
+/// Understands a subset of PCRE: a sequence of literals, `.`, `\d \w \s` (and negations) and bracket classes, each with an optional greedy or lazy quantifier,
+/// optionally anchored with `^` and `$`. Anything else (groups, alternation, assertions, ...) disables the prefilter, and check() always returns UNKNOWN.
+///
+/// Derived from a supported pattern:
+/// - minimum length
+/// - required literal prefix (if anchored at start) and suffix (if anchored at end)
+/// - if anchored at both ends and at most one atom has a variable repeat count (e.g. `^[A-Z_]+$`, `^item_\d{3}$`), an exact linear-time matcher using 256-bit lookup tables
+class PatternPrefilter {
+public:
+	enum Result {
+		NO_MATCH,
+		MATCH,
+		// The full regex engine has to decide
+		UNKNOWN,
+	};
+
+private:
+	struct CharSet {
+		// One bit per code point below 256
+		uint64_t bits[4] = { 0, 0, 0, 0 };
+		// Whether code points >= 256 are in the set
+		bool others = false;
+
+		bool has(uint32_t c) const {
+			return c < 256 ? (bits[c >> 6] >> (c & 63)) & 1 : others;
+		}
+		void add(uint32_t c) { bits[c >> 6] |= uint64_t{ 1 } << (c & 63); }
+		void add_range(uint32_t from, uint32_t to);
+		void invert();
+		/// Adds the set for `\d \D \w \W \s \S`, returns false for any other escape
+		bool add_class_escape(wchar_t escape);
+		/// Returns -1 if the set has zero or more than one element
+		int single_char() const;
+	};
+
+	struct Atom {
+		CharSet set;
+		int min;
+		// -1 for unbounded
+		int max;
+	};
+
+	bool supported = false;
+	bool anchored_start = false;
+	bool anchored_end = false;
+	std::vector<Atom> atoms;
+	// Index of the only atom with min != max, -1 if there is none, -2 if there are more than one
+	int variable_atom = -1;
+	// Whether every atom matches exactly one literal character exactly once (the pattern is a plain string)
+	bool literal = false;
+	int min_length = 0;
+	// Latin-1, as only literals below 256 are supported
+	std::string prefix;
+	std::string suffix;
+
+	bool _parse(const wchar_t* source, int length);
+	Result _match_exact(const wchar_t* value, int length) const;
+
+public:
+	static PatternPrefilter analyse(const wchar_t* source, int length);
+
+	bool is_supported() const { return supported; }
+	Result check(const wchar_t* value, int length) const;
+};
+
+} // namespace godot::structural_inspector
@@ -1,21 +1,301 @@
 #include "Plugin.hpp"
+#include "ProjectValidator.hpp"
 #include "ResourceEditor.hpp"
+#include "SchemaBinary.hpp"
 #include "SchemaEditor.hpp"
 
+#include <EditorFileSystem.hpp>
+#include <File.hpp>
 #include <GodotGlobal.hpp>
 #include <Object.hpp>
+#include <ProjectSettings.hpp>
 #include <ResourceLoader.hpp>
+#include <EditorInterface.hpp>
+#include <EditorSettings.hpp>
 #include <Script.hpp>
+#include <algorithm>
+#include <iterator>
 
 #include <JSON.hpp>
 
 using namespace godot;
 using namespace godot::structural_inspector;
 
+static uint64_t get_modified_time(const String& path) {
+	return Ref{ File::_new() }->get_modified_time(path);
+}
+
+/// Empty if `object` has no script
+static String get_script_path(const Object* object) {
+	auto script = Ref{ static_cast<Script*>(object->get_script()) };
+	return script.is_valid() ? script->get_path() : String{};
+}
+
+std::vector<Object*> InspectorPlugin::_get_targets(const Object* object) const {
+	// The inspector edits several selected nodes through a MultiNodeEdit, which only forwards property names to them
+	if (selection && object->get_class() == "MultiNodeEdit") {
+		std::vector<Object*> targets;
+		Array nodes = selection->get_selected_nodes();
+		for (int i = 0; i < nodes.size(); ++i) {
+			targets.push_back(nodes[i]);
+		}
+		return targets;
+	}
+	return { const_cast<Object*>(object) };
+}
+
+String InspectorPlugin::_get_edited_script_path(const Object* object) const {
+	auto targets = _get_targets(object);
+	if (targets.empty()) {
+		return String{};
+	}
+	// Objects can only be edited together if they share the schema, i.e. the script
+	auto script_path = get_script_path(targets.front());
+	for (auto target : targets) {
+		if (get_script_path(target) != script_path) {
+			return String{};
+		}
+	}
+	return script_path;
+}
+
+InspectorPlugin::CachedSchema* InspectorPlugin::_get_schema_for(const Object* object) {
+	auto script_path = _get_edited_script_path(object);
+	if (script_path.empty()) {
+		return nullptr;
+	}
+
+	auto loader = ResourceLoader::get_singleton();
+	if (auto it = schema_cache.find(script_path); it != schema_cache.end()) {
+		auto& entry = it->second;
+		if (entry.resource.is_null() && loader->has_cached(entry.schema_path)) {
+			// The schema was opened (e.g. for editing) after we loaded its compiled form, follow the live resource from now on so that unsaved edits show up
+			_track_resource(entry, script_path, loader->load(entry.schema_path));
+		}
+		if (entry.stale) {
+			// Most edits in the schema editor (e.g. typing an incomplete pattern) don't change the compiled result,
+			// keep the old one in that case so that the compiled schema can keep being used as an identity
+			auto compiled = entry.resource->compile();
+			if (compiled->get_fingerprint() != entry.compiled->get_fingerprint()) {
+				entry.compiled = std::move(compiled);
+			}
+			entry.stale = false;
+		}
+		return &entry;
+	}
+
+	if (pending_loads.count(script_path) || failed_loads.count(script_path)) {
+		return nullptr;
+	}
+	auto schema_path = ::get_schema_path(script_path);
+	if (!loader->exists(schema_path)) {
+		return nullptr;
+	}
+
+	// TODO allow custom schema path
+	// if (script->get_script_constant_map().has("resource_schema_path")) {
+	// 	String path = script->get_script_constant_map()["resource_schema_path"];
+	// 	Ref<ResourceSchema> schema = ResourceLoader::get_singleton()->load(path);
+	// 	return schema.is_valid();
+	// }
+
+	// Reading the schema from disk happens on the loader thread, the inspector is refreshed once it is done
+	// A loaded schema resource however may have unsaved edits, and only needs compiling
+	if (!loader->has_cached(schema_path)) {
+		_queue_load(script_path, schema_path);
+		return nullptr;
+	}
+
+	Ref<ResourceSchema> resource = loader->load(schema_path);
+	if (resource.is_null()) {
+		return nullptr;
+	}
+
+	auto& entry = schema_cache[script_path];
+	entry.schema_path = schema_path;
+	_track_resource(entry, script_path, resource);
+	entry.compiled = resource->compile();
+	entry.stale = false;
+	entry.modified_time = get_modified_time(schema_path);
+	return &entry;
+}
+
+void InspectorPlugin::_queue_load(const String& script_path, const String& schema_path) {
+	auto id = next_load_id++;
+	pending_loads[script_path] = PendingLoad{ id, {} };
+	if (!load_pool) {
+		// Loads are rare, one thread keeps them from competing with the editor for cores
+		load_pool = std::make_unique<WorkStealingPool>(1);
+	}
+
+	load_pool->submit([this, id, script_path, schema_path]() {
+		// Taken before reading, so that a change made while loading is noticed afterwards
+		LoadResult result{ id, script_path, schema_path, Ref<ResourceSchema>{}, nullptr, get_modified_time(schema_path) };
+		// The compiled blob written on save skips parsing the text resource entirely
+		if (auto compiled = ::load_schema_binary(schema_path)) {
+			result.compiled = std::move(compiled);
+		} else {
+			Ref<ResourceSchema> resource = ResourceLoader::get_singleton()->load(schema_path);
+			if (resource.is_valid()) {
+				auto compiled = resource->compile();
+				// Freshly loaded from disk, so the blob matches the file
+				::save_schema_binary(schema_path, *compiled);
+				result.resource = resource;
+				result.compiled = std::move(compiled);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ loaded_mutex };
+			loaded.push_back(std::move(result));
+		}
+		// Deferred calls are thread safe, and run on the main thread
+		call_deferred("_schema_loaded");
+	});
+}
+
+void InspectorPlugin::_schema_loaded() {
+	std::vector<LoadResult> results;
+	{
+		std::lock_guard<std::mutex> lock{ loaded_mutex };
+		results.swap(loaded);
+	}
+
+	for (auto& result : results) {
+		auto it = pending_loads.find(result.script_path);
+		if (it == pending_loads.end() || it->second.id != result.id) {
+			// Invalidated while loading
+			continue;
+		}
+		auto pending = std::move(it->second);
+		pending_loads.erase(it);
+
+		if (!result.compiled) {
+			ERR_PRINT("Failed to load schema " + result.schema_path);
+			failed_loads.insert(result.script_path);
+		} else {
+			auto& entry = schema_cache[result.script_path];
+			entry.schema_path = result.schema_path;
+			entry.compiled = std::move(result.compiled);
+			entry.modified_time = result.modified_time;
+			if (result.resource.is_valid()) {
+				_track_resource(entry, result.script_path, result.resource);
+				// Compiled from this very resource
+				entry.stale = false;
+			}
+		}
+		_refresh_waiting(pending);
+	}
+}
+
+void InspectorPlugin::_placeholder_exiting(Label* placeholder) {
+	for (auto& [script_path, pending] : pending_loads) {
+		auto& waiting = pending.waiting;
+		waiting.erase(
+				std::remove_if(waiting.begin(), waiting.end(), [&](auto& entry) { return entry.first == placeholder; }),
+				waiting.end());
+	}
+}
+
+void InspectorPlugin::_refresh_waiting(PendingLoad& pending) {
+	auto waiting = std::move(pending.waiting);
+	pending.waiting.clear();
+	for (auto [placeholder, object] : waiting) {
+		placeholder->disconnect("tree_exiting", this, "_placeholder_exiting");
+		// Makes the inspector parse the object again, this time with the schema ready (or failed)
+		object->property_list_changed_notify();
+	}
+}
+
+static constexpr size_t MAX_RECENT_SCRIPTS = 16;
+
+void InspectorPlugin::_touch_recent(const String& script_path) {
+	auto it = std::find(recent_scripts.begin(), recent_scripts.end(), script_path);
+	if (it == recent_scripts.begin() && it != recent_scripts.end()) {
+		return;
+	}
+	if (it != recent_scripts.end()) {
+		recent_scripts.erase(it);
+	}
+	recent_scripts.insert(recent_scripts.begin(), script_path);
+	if (recent_scripts.size() > MAX_RECENT_SCRIPTS) {
+		recent_scripts.pop_back();
+	}
+}
+
+void InspectorPlugin::_track_resource(CachedSchema& entry, const String& script_path, Ref<ResourceSchema> resource) {
+	if (resource.is_null()) {
+		return;
+	}
+
+	// Edits made through the schema inspector go through ResourceSchema::set_properties(), which emits "changed"
+	resource->connect("changed", this, "_schema_changed", Array::make(script_path));
+	entry.resource = resource;
+	entry.stale = true;
+}
+
+void InspectorPlugin::_erase_cache_entry(std::unordered_map<String, CachedSchema>::iterator it) {
+	auto& resource = it->second.resource;
+	if (resource.is_valid() && resource->is_connected("changed", this, "_schema_changed")) {
+		resource->disconnect("changed", this, "_schema_changed");
+	}
+	schema_cache.erase(it);
+}
+
+void InspectorPlugin::_schema_changed(const String script_path) {
+	if (auto it = schema_cache.find(script_path); it != schema_cache.end()) {
+		it->second.stale = true;
+	}
+}
+
+void InspectorPlugin::_resource_saved(Ref<Resource> resource) {
+	auto schema = Object::cast_to<ResourceSchema>(resource.ptr());
+	if (!schema) {
+		return;
+	}
+
+	// Compile step, so that later sessions (and the project validator) can load the schema without parsing the text resource
+	auto path = schema->get_path();
+	::save_schema_binary(path, *schema->compile());
+
+	// Saving the instance we already track doesn't change anything, its edits were already picked up through "changed".
+	// A different instance being saved to the same path (e.g. "Save As" over it) however replaces the schema, and one that failed to load may load fine now.
+	for (auto& [script_path, entry] : schema_cache) {
+		if (entry.schema_path == path && entry.resource.ptr() == schema) {
+			entry.modified_time = get_modified_time(path);
+			return;
+		}
+	}
+	invalidate_schema(path);
+}
+
+void InspectorPlugin::_filesystem_changed() {
+	// Schema files changed outside the editor (version control, an external editor) only show up as a different modification time
+	std::vector<String> changed;
+	for (auto& [script_path, entry] : schema_cache) {
+		if (get_modified_time(entry.schema_path) != entry.modified_time) {
+			changed.push_back(entry.schema_path);
+		}
+	}
+	for (auto& schema_path : changed) {
+		invalidate_schema(schema_path);
+	}
+	// These may load fine now, and are only tried again once they are needed
+	failed_loads.clear();
+}
+
 void InspectorPlugin::_register_methods() {
 	register_method("_notification", &InspectorPlugin::_notification);
+	register_method("_schema_changed", &InspectorPlugin::_schema_changed);
+	register_method("_resource_saved", &InspectorPlugin::_resource_saved);
+	register_method("_filesystem_changed", &InspectorPlugin::_filesystem_changed);
+	register_method("_schema_loaded", &InspectorPlugin::_schema_loaded);
+	register_method("_placeholder_exiting", &InspectorPlugin::_placeholder_exiting);
 	register_method("can_handle", &InspectorPlugin::can_handle);
+	register_method("parse_begin", &InspectorPlugin::parse_begin);
 	register_method("parse_property", &InspectorPlugin::parse_property);
+	register_method("prefetch", &InspectorPlugin::prefetch);
+	register_method("get_recent_scripts", &InspectorPlugin::get_recent_scripts);
 }
 
 void InspectorPlugin::_init() {
@@ -29,29 +309,31 @@ bool InspectorPlugin::can_handle(const Object* object) {
 		return true;
 	}
 
-	auto script = Ref{ static_cast<Script*>(object->get_script()) };
-	if (script.is_valid()) {
-		auto script_path = script->get_path();
-		auto schema_path = script_path.substr(0, script_path.find_last(".")) + ".schema.tres";
-		if (ResourceLoader::get_singleton()->exists(schema_path)) {
-			auto resource = ResourceLoader::get_singleton()->load(schema_path);
-			return Object::cast_to<ResourceSchema>(resource.ptr()) != nullptr;
-		}
+	auto script_path = _get_edited_script_path(object);
+	if (_get_schema_for(object)) {
+		_touch_recent(script_path);
+		return true;
+	}
+	// Handled once the schema is loaded, parse_begin() shows a placeholder until then
+	return pending_loads.count(script_path) > 0;
+}
 
-		// TODO allow custom schema path
-		// if (script->get_script_constant_map().has("resource_schema_path")) {
-		// 	String path = script->get_script_constant_map()["resource_schema_path"];
-		// 	Ref<ResourceSchema> schema = ResourceLoader::get_singleton()->load(path);
-		// 	return schema.is_valid();
-		// }
+void InspectorPlugin::parse_begin(const Object* object) {
+	auto it = pending_loads.find(_get_edited_script_path(object));
+	if (it == pending_loads.end()) {
+		return;
 	}
 
-	return false;
+	auto placeholder = Label::_new();
+	placeholder->set_text("Loading schema...");
+	placeholder->connect("tree_exiting", this, "_placeholder_exiting", Array::make(placeholder));
+	add_custom_control(placeholder);
+	it->second.waiting.emplace_back(placeholder, const_cast<Object*>(object));
 }
 
 bool InspectorPlugin::parse_property(const Object* object, const int64_t type, const String path, const int64_t hint, const String hint_text, const int64_t usage) {
 	if (Object::cast_to<ResourceSchema>(object) != nullptr) {
-		if (path == "properties") {
+		if (path == "properties" || path == "definitions") {
 			add_property_editor(path, ResourceSchemaInspectorProperty::_new());
 			return true;
 		} else {
@@ -60,46 +342,171 @@ bool InspectorPlugin::parse_property(const Object* object, const int64_t type, c
 	}
 
 	// Since the object passed the test in `can_handle`, and it's not a ResourceSchema, it must have a valid script attached
-	auto script = Ref{ static_cast<Script*>(object->get_script()) };
-	auto script_path = script->get_path();
-	auto schema_path = script_path.substr(0, script_path.find_last(".")) + ".schema.tres";
-	Ref<ResourceSchema> ref = ResourceLoader::get_singleton()->load(schema_path);
-	if (ref.is_valid()) {
-		if (auto res = Object::cast_to<ResourceSchema>(ref.ptr())) {
-			if (auto schema = res->compute_info_for(path)) {
-				auto prop = ResourceInspectorProperty::_new();
-				prop->_custom_init(std::move(schema));
-
-				add_property_editor(path, prop);
-				return true;
+	if (auto entry = _get_schema_for(object)) {
+		if (auto schema = entry->compiled->find_root(path)) {
+			auto prop = ResourceInspectorProperty::_new();
+			prop->_custom_init(entry->compiled, schema, history);
+			if (auto targets = _get_targets(object); targets.size() > 1) {
+				prop->set_edit_targets(std::move(targets));
 			}
+
+			add_property_editor(path, prop);
+			return true;
 		}
 	}
 
 	return false;
 }
 
+void InspectorPlugin::set_edit_history(Ref<EditHistory> history) {
+	this->history = history;
+}
+
+void InspectorPlugin::set_editor_selection(EditorSelection* selection) {
+	this->selection = selection;
+}
+
+void InspectorPlugin::invalidate_schema(const String& schema_path) {
+	for (auto it = schema_cache.begin(); it != schema_cache.end();) {
+		auto next = std::next(it);
+		if (it->second.schema_path == schema_path) {
+			_erase_cache_entry(it);
+		}
+		it = next;
+	}
+	// Results of loads already running are dropped, the refreshed inspectors start a new one
+	for (auto it = pending_loads.begin(); it != pending_loads.end();) {
+		if (::get_schema_path(it->first) == schema_path) {
+			_refresh_waiting(it->second);
+			it = pending_loads.erase(it);
+		} else {
+			++it;
+		}
+	}
+	for (auto it = failed_loads.begin(); it != failed_loads.end();) {
+		it = ::get_schema_path(*it) == schema_path ? failed_loads.erase(it) : std::next(it);
+	}
+}
+
+void InspectorPlugin::clear_cache() {
+	while (!schema_cache.empty()) {
+		_erase_cache_entry(schema_cache.begin());
+	}
+	for (auto& [script_path, pending] : pending_loads) {
+		_refresh_waiting(pending);
+	}
+	pending_loads.clear();
+	failed_loads.clear();
+}
+
+void InspectorPlugin::prefetch(const String& script_path) {
+	if (schema_cache.count(script_path) || pending_loads.count(script_path) || failed_loads.count(script_path)) {
+		return;
+	}
+
+	auto schema_path = ::get_schema_path(script_path);
+	auto loader = ResourceLoader::get_singleton();
+	// Loaded schema resources are compiled on first use, see _get_schema_for()
+	if (!loader->exists(schema_path) || loader->has_cached(schema_path)) {
+		return;
+	}
+	_queue_load(script_path, schema_path);
+}
+
+Array InspectorPlugin::get_recent_scripts() const {
+	Array result;
+	for (auto& script_path : recent_scripts) {
+		result.append(script_path);
+	}
+	return result;
+}
+
 InspectorPlugin::InspectorPlugin() {
 }
 
 InspectorPlugin::~InspectorPlugin() {
 }
 
+static const char* VALIDATE_PROJECT_MENU_ITEM = "Validate Schema'd Resources";
+static const char* PROJECT_METADATA_SECTION = "structural_inspector";
+
+void Plugin::_validate_project(Variant user_data) {
+	auto validator = Ref{ ProjectValidator::_new() };
+	Dictionary report = validator->validate_project("res://");
+
+	Array results = report["results"];
+	for (int i = 0; i < results.size(); ++i) {
+		Dictionary result = results[i];
+		String resource = result["resource"];
+		Array errors = result["errors"];
+		for (int j = 0; j < errors.size(); ++j) {
+			Dictionary error = errors[j];
+			String path = error["path"];
+			String message = error["message"];
+			Godot::print(resource + ": " + path + ": " + message);
+		}
+	}
+
+	int checked = report["checked"];
+	int failed = report["failed"];
+	int64_t elapsed = report["elapsed_msec"];
+	Godot::print("Validated " + String::num_int64(checked) + " resources, " + String::num_int64(failed) + " failed (" + String::num_int64(elapsed) + " ms)");
+}
+
 void Plugin::_register_methods() {
 	register_method("_notification", &Plugin::_notification);
+	register_method("_validate_project", &Plugin::_validate_project);
 }
 
 void Plugin::_init() {
 }
 
+/// Registers the setting with its default value, so that it shows up in the project settings dialog
+static void add_project_setting(const char* name, const Variant& default_value, Variant::Type type) {
+	auto settings = ProjectSettings::get_singleton();
+	if (!settings->has_setting(name)) {
+		settings->set_setting(name, default_value);
+	}
+	settings->set_initial_value(name, default_value);
+	Dictionary info;
+	info["name"] = name;
+	info["type"] = type;
+	settings->add_property_info(info);
+}
+
 void Plugin::_notification(int what) {
 	switch (what) {
 		case NOTIFICATION_ENTER_TREE: {
+			add_project_setting(MAX_SCHEMA_DEPTH_SETTING, DEFAULT_MAX_SCHEMA_DEPTH, Variant::INT);
+			add_project_setting(EDITOR_RELEASE_DELAY_SETTING, DEFAULT_EDITOR_RELEASE_DELAY, Variant::REAL);
+			add_project_setting(EDIT_COALESCE_WINDOW_SETTING, DEFAULT_EDIT_COALESCE_WINDOW, Variant::REAL);
+			add_project_setting(BUILD_BUDGET_SETTING, DEFAULT_BUILD_BUDGET, Variant::REAL);
+			add_project_setting(UNDO_MEMORY_LIMIT_SETTING, DEFAULT_UNDO_MEMORY_LIMIT, Variant::INT);
+
+			auto history = Ref{ EditHistory::_new() };
+			history->_custom_init(get_undo_redo());
+
 			inspector_plugin = Ref{ InspectorPlugin::_new() };
+			inspector_plugin->set_edit_history(history);
+			inspector_plugin->set_editor_selection(get_editor_interface()->get_selection());
 			add_inspector_plugin(inspector_plugin);
+			connect("resource_saved", inspector_plugin.ptr(), "_resource_saved");
+			get_editor_interface()->get_resource_filesystem()->connect("filesystem_changed", inspector_plugin.ptr(), "_filesystem_changed");
+			add_tool_menu_item(VALIDATE_PROJECT_MENU_ITEM, this, "_validate_project");
+
+			// Schemas used in the last session are likely to be needed again, load them before anything gets selected
+			Array recent = get_editor_interface()->get_editor_settings()->get_project_metadata(PROJECT_METADATA_SECTION, "recent_scripts", Array{});
+			for (int i = 0; i < recent.size(); ++i) {
+				inspector_plugin->prefetch(recent[i]);
+			}
 		} break;
 		case NOTIFICATION_EXIT_TREE: {
+			get_editor_interface()->get_editor_settings()->set_project_metadata(PROJECT_METADATA_SECTION, "recent_scripts", inspector_plugin->get_recent_scripts());
+			remove_tool_menu_item(VALIDATE_PROJECT_MENU_ITEM);
+			disconnect("resource_saved", inspector_plugin.ptr(), "_resource_saved");
+			get_editor_interface()->get_resource_filesystem()->disconnect("filesystem_changed", inspector_plugin.ptr(), "_filesystem_changed");
 			remove_inspector_plugin(inspector_plugin);
+			inspector_plugin->clear_cache();
 		} break;
 	}
 }
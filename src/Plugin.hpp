@@ -1,23 +1,110 @@
 #pragma once
 
+#include "CompiledSchema.hpp"
+#include "EditHistory.hpp"
+#include "Schema.hpp"
+#include "ThreadPool.hpp"
+
 #include <EditorInspectorPlugin.hpp>
 #include <EditorPlugin.hpp>
+#include <EditorSelection.hpp>
 #include <Godot.hpp>
+#include <Label.hpp>
+#include <Resource.hpp>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace godot::structural_inspector {
 
 class InspectorPlugin : public EditorInspectorPlugin {
 	GODOT_CLASS(InspectorPlugin, EditorInspectorPlugin)
+private:
+	struct CachedSchema {
+		String schema_path;
+		// Null if `compiled` was loaded from the compiled blob, and the schema resource hasn't been loaded since
+		Ref<ResourceSchema> resource;
+		// Every property editor created from this entry shares the same compiled schema
+		std::shared_ptr<const CompiledSchema> compiled;
+		// Set when `resource` emitted "changed", `compiled` is only replaced if the recompiled schema has a different fingerprint
+		bool stale = false;
+		// Of the schema file when `compiled` was made from it, a different one means it was changed outside the editor (e.g. by a checkout)
+		uint64_t modified_time = 0;
+	};
+	// Keyed by the path of the script that the schema applies to
+	std::unordered_map<String, CachedSchema> schema_cache;
+	// Shared by all properties, so that undoing still works after the inspector moved on to another object
+	Ref<EditHistory> history;
+	// Used to find the nodes behind a MultiNodeEdit
+	EditorSelection* selection = nullptr;
+
+	struct PendingLoad {
+		// Matched against LoadResult::id, so that a load started before invalidate_schema() doesn't fill the cache
+		uint64_t id;
+		// Inspectors showing a "Loading schema..." placeholder for the object, refreshed once the schema is ready
+		std::vector<std::pair<Label*, Object*>> waiting;
+	};
+	struct LoadResult {
+		uint64_t id;
+		String script_path;
+		String schema_path;
+		// Null if loaded from the compiled blob
+		Ref<ResourceSchema> resource;
+		// Null if loading failed
+		std::shared_ptr<const CompiledSchema> compiled;
+		uint64_t modified_time;
+	};
+	// Schemas being loaded on the loader thread, by script path. Only touched on the main thread.
+	std::unordered_map<String, PendingLoad> pending_loads;
+	// Scripts whose schema failed to load, so that refreshing the inspector doesn't start loading it again
+	std::unordered_set<String> failed_loads;
+	uint64_t next_load_id = 0;
+	// Filled by the loader thread, and emptied by _schema_loaded() on the main thread
+	std::mutex loaded_mutex;
+	std::vector<LoadResult> loaded;
+	// Most recently used first, saved in the project metadata so that the next session can prefetch them
+	std::vector<String> recent_scripts;
+	// Declared last so that it is destroyed (finishing its tasks) before the members they use
+	std::unique_ptr<WorkStealingPool> load_pool;
+
+	/// The objects edited through `object`: the selected nodes for a MultiNodeEdit, and `object` itself otherwise
+	std::vector<Object*> _get_targets(const Object* object) const;
+	/// Script shared by all the objects edited through `object`, empty if they don't have the same one
+	String _get_edited_script_path(const Object* object) const;
+	CachedSchema* _get_schema_for(const Object* object);
+	void _queue_load(const String& script_path, const String& schema_path);
+	void _schema_loaded();
+	void _placeholder_exiting(Label* placeholder);
+	void _refresh_waiting(PendingLoad& pending);
+	void _touch_recent(const String& script_path);
+	void _track_resource(CachedSchema& entry, const String& script_path, Ref<ResourceSchema> resource);
+	void _erase_cache_entry(std::unordered_map<String, CachedSchema>::iterator it);
+	void _schema_changed(const String script_path);
+	void _resource_saved(Ref<Resource> resource);
+	void _filesystem_changed();
+
 public:
 	static void _register_methods();
 	void _init();
 	void _notification(int what);
 
 	bool can_handle(const Object* object);
+	void parse_begin(const Object* object);
 	bool parse_property(const Object* object, const int64_t type, const String path, const int64_t hint, const String hint_text, const int64_t usage);
 
+	void set_edit_history(Ref<EditHistory> history);
+	void set_editor_selection(EditorSelection* selection);
+
+	/// Drops everything cached for the schema file at `schema_path`, it is loaded again the next time it is needed
 	void invalidate_schema(const String& schema_path);
+	void clear_cache();
+
+	/// Loads the schema of the script at `script_path` on the loader thread, unless it is already loaded or being loaded
+	void prefetch(const String& script_path);
+	/// Scripts whose schema was used recently, most recent first
+	Array get_recent_scripts() const;
 
 	InspectorPlugin();
 	~InspectorPlugin();
@@ -28,6 +115,8 @@ class Plugin : public EditorPlugin {
 private:
 	Ref<InspectorPlugin> inspector_plugin;
 
+	void _validate_project(Variant user_data);
+
 public:
 	static void _register_methods();
 	void _init();
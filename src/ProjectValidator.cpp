@@ -0,0 +1,237 @@
+#include "ProjectValidator.hpp"
+#include "SchemaBinary.hpp"
+#include "ThreadPool.hpp"
+#include "Validation.hpp"
+
+#include <Directory.hpp>
+#include <File.hpp>
+#include <OS.hpp>
+#include <Resource.hpp>
+#include <ResourceLoader.hpp>
+#include <Script.hpp>
+#include <algorithm>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+static bool is_candidate_file(const String& file_name) {
+	auto extension = file_name.get_extension();
+	if (extension != "tres" && extension != "res") {
+		return false;
+	}
+	// Schemas themselves are resources too, skip them
+	return file_name.get_basename().get_extension() != "schema";
+}
+
+void ProjectValidator::_collect_files(const String& dir_path, std::vector<String>& files) {
+	auto dir = Ref{ Directory::_new() };
+	if (dir->open(dir_path) != Error::OK) {
+		ERR_PRINT("Failed to open directory " + dir_path);
+		return;
+	}
+
+	// Skipping hidden entries also skips `.import`
+	dir->list_dir_begin(true, true);
+	for (auto name = dir->get_next(); !name.empty(); name = dir->get_next()) {
+		auto path = dir_path.plus_file(name);
+		if (dir->current_is_dir()) {
+			_collect_files(path, files);
+		} else if (is_candidate_file(name)) {
+			files.push_back(path);
+		}
+	}
+	dir->list_dir_end();
+}
+
+ProjectValidator::SchemaEntry ProjectValidator::_get_schema(const String& schema_path) {
+	// Schemas are few compared to resources, so loading them while holding the lock is fine
+	std::lock_guard<std::mutex> lock{ schemas_mutex };
+	if (auto it = schemas.find(schema_path); it != schemas.end()) {
+		return it->second;
+	}
+
+	// Failures are cached too, so that each schema is only tried (and reported) once
+	auto& entry = schemas[schema_path];
+	if (auto compiled = ::load_schema_binary(schema_path)) {
+		entry.exists = true;
+		entry.compiled = std::move(compiled);
+	} else if (ResourceLoader::get_singleton()->exists(schema_path)) {
+		entry.exists = true;
+		Ref<ResourceSchema> resource = ResourceLoader::get_singleton()->load(schema_path);
+		if (resource.is_valid()) {
+			entry.compiled = resource->compile();
+		} else {
+			ERR_PRINT("Failed to load schema " + schema_path);
+		}
+	}
+	return entry;
+}
+
+bool ProjectValidator::_may_have_schema(const String& resource_path) {
+	// Binary resources can't be peeked into cheaply, just load them
+	if (resource_path.get_extension() != "tres") {
+		return true;
+	}
+
+	// Scan the header of text resources for referenced scripts, and skip loading the resource entirely if none of them has a schema.
+	// The main resource's script is always an ext_resource (or a built-in script, which can't have a sibling schema).
+	auto file = Ref{ File::_new() };
+	if (file->open(resource_path, File::READ) != Error::OK) {
+		return true;
+	}
+
+	static const String path_prefix = "path=\"";
+	bool found = false;
+	while (!file->eof_reached()) {
+		auto line = file->get_line();
+		if (line.find("[ext_resource") != 0) {
+			if (line.find("[") == 0 && line.find("[gd_resource") != 0) {
+				// Past the ext_resource section
+				break;
+			}
+			continue;
+		}
+		if (line.find("type=\"Script\"") == -1) {
+			continue;
+		}
+
+		auto begin = line.find(path_prefix);
+		if (begin == -1) {
+			continue;
+		}
+		begin += path_prefix.length();
+		auto end = line.find("\"", begin);
+		if (end == -1) {
+			continue;
+		}
+
+		// A schema that fails to load still makes the resource fail, instead of being skipped
+		if (_get_schema(get_schema_path(line.substr(begin, end - begin))).exists) {
+			found = true;
+			break;
+		}
+	}
+	file->close();
+	return found;
+}
+
+/// A result for a resource that couldn't be validated at all
+static Dictionary make_failed_result(const String& resource_path, const String& schema_path, const String& message) {
+	Dictionary result;
+	result["resource"] = resource_path;
+	result["schema"] = schema_path;
+	Dictionary error;
+	error["path"] = "";
+	error["message"] = message;
+	result["errors"] = Array::make(error);
+	return result;
+}
+
+Dictionary ProjectValidator::_validate_file(const String& resource_path) {
+	if (!_may_have_schema(resource_path)) {
+		return Dictionary{};
+	}
+
+	Ref<Resource> resource = ResourceLoader::get_singleton()->load(resource_path);
+	if (resource.is_null()) {
+		return make_failed_result(resource_path, "", "Failed to load resource");
+	}
+
+	auto script = Ref{ static_cast<Script*>(resource->get_script()) };
+	if (script.is_null()) {
+		return Dictionary{};
+	}
+
+	auto schema_path = get_schema_path(script->get_path());
+	auto schema = _get_schema(schema_path);
+	if (!schema.exists) {
+		return Dictionary{};
+	}
+	if (!schema.compiled) {
+		return make_failed_result(resource_path, schema_path, "Failed to load schema " + schema_path);
+	}
+	auto& compiled = schema.compiled;
+
+	SchemaValidator validator;
+	std::vector<ValidationError> errors;
+	for (auto& [name, id] : compiled->get_roots()) {
+		validator.validate(*compiled, compiled->get_node(id), resource->get(name), name, errors);
+	}
+
+	Dictionary result;
+	result["resource"] = resource_path;
+	result["schema"] = schema_path;
+	result["errors"] = errors_to_array(errors);
+	return result;
+}
+
+void ProjectValidator::_register_methods() {
+	register_method("validate_project", &ProjectValidator::validate_project);
+	register_property<ProjectValidator, int>("thread_count", &ProjectValidator::set_thread_count, &ProjectValidator::get_thread_count, 0);
+}
+
+void ProjectValidator::_init() {
+}
+
+int ProjectValidator::get_thread_count() {
+	return thread_count;
+}
+
+void ProjectValidator::set_thread_count(int thread_count) {
+	this->thread_count = thread_count;
+}
+
+Dictionary ProjectValidator::validate_project(String root_dir) {
+	auto start = OS::get_singleton()->get_ticks_msec();
+
+	std::vector<String> files;
+	_collect_files(root_dir, files);
+
+	std::vector<Dictionary> results(files.size());
+	size_t used_threads;
+	{
+		WorkStealingPool pool{ static_cast<size_t>(std::max(thread_count, 0)) };
+		used_threads = pool.get_thread_count();
+		for (size_t i = 0; i < files.size(); ++i) {
+			// Each task writes its own slot, so results keep the (deterministic) discovery order
+			pool.submit([this, &files, &results, i]() {
+				results[i] = _validate_file(files[i]);
+			});
+		}
+		pool.wait();
+	}
+
+	Array report_results;
+	int checked = 0;
+	int failed = 0;
+	for (auto& result : results) {
+		if (result.empty()) {
+			continue;
+		}
+		++checked;
+		Array errors = result["errors"];
+		if (!errors.empty()) {
+			++failed;
+		}
+		report_results.append(result);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ schemas_mutex };
+		schemas.clear();
+	}
+
+	Dictionary report;
+	report["checked"] = checked;
+	report["failed"] = failed;
+	report["threads"] = static_cast<int>(used_threads);
+	report["elapsed_msec"] = OS::get_singleton()->get_ticks_msec() - start;
+	report["results"] = report_results;
+	return report;
+}
+
+ProjectValidator::ProjectValidator() {
+}
+
+ProjectValidator::~ProjectValidator() {
+}
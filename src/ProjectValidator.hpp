@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CompiledSchema.hpp"
+#include "Schema.hpp"
+
+#include <Godot.hpp>
+#include <Reference.hpp>
+#include <String.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+/// Validates every resource in the project whose script has a sibling schema (the same `script -> .schema.tres` rule the inspector uses).
+/// Resources are loaded and validated on a WorkStealingPool. Usable from the editor, and headless through `validate_project.gd`.
+class ProjectValidator : public Reference {
+	GODOT_CLASS(ProjectValidator, Reference)
+private:
+	struct SchemaEntry {
+		// Whether there is a schema at the path, resources using one that failed to load are reported as failed instead of skipped
+		bool exists = false;
+		// nullptr if there is no schema at the path, or it failed to load
+		std::shared_ptr<const CompiledSchema> compiled;
+	};
+
+	int thread_count = 0;
+
+	// Shared between workers, keyed by schema path
+	std::mutex schemas_mutex;
+	std::unordered_map<String, SchemaEntry> schemas;
+
+	void _collect_files(const String& dir_path, std::vector<String>& files);
+	SchemaEntry _get_schema(const String& schema_path);
+	bool _may_have_schema(const String& resource_path);
+	Dictionary _validate_file(const String& resource_path);
+
+public:
+	static void _register_methods();
+	void _init();
+
+	int get_thread_count();
+	void set_thread_count(int thread_count);
+
+	/// Returns a report of the form
+	/// `{ "checked": int, "failed": int, "threads": int, "elapsed_msec": int, "results": [{ "resource": String, "schema": String, "errors": [{ "path": String, "message": String }] }] }`
+	Dictionary validate_project(String root_dir);
+
+	ProjectValidator();
+	~ProjectValidator();
+};
+
+} // namespace godot::structural_inspector
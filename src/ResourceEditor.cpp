@@ -1,11 +1,18 @@
 #include "ResourceEditor.hpp"
 
 #include <CheckBox.hpp>
+#include <GlobalConstants.hpp>
 #include <InputEvent.hpp>
 #include <InputEventMouseButton.hpp>
+#include <InputEventMouseMotion.hpp>
 #include <JSON.hpp>
+#include <OS.hpp>
 #include <PopupMenu.hpp>
+#include <ProjectSettings.hpp>
 #include <Texture.hpp>
+#include <algorithm>
+#include <climits>
+#include <numeric>
 #include <utility>
 
 using namespace godot;
@@ -17,57 +24,140 @@ void ResourceEditor::_register_methods() {
 void ResourceEditor::_init() {
 }
 
+ResourceEditor* ResourceEditor::get_parent_editor() const {
+	return parent;
+}
+
+void ResourceEditor::_child_clicked(ResourceEditor* child, bool range, bool toggle) {
+}
+
+void ResourceEditor::set_parent_editor(ResourceEditor* parent) {
+	this->parent = parent;
+}
+
 void ResourceEditor::set_key(const Variant& key) {
+	this->key = key;
 }
 
 void ResourceEditor::read(const Variant& value) {
 }
 
-Variant ResourceEditor::save() const {
+Variant ResourceEditor::serialize() const {
 	return Variant{};
 }
 
+Variant ResourceEditor::save() {
+	if (dirty) {
+		saved_value = serialize();
+		dirty = false;
+	}
+	return saved_value;
+}
+
+void ResourceEditor::mark_dirty() {
+	// Can't stop at the first editor that is already dirty: a parent that didn't save this editor (e.g. a free ArrayEditor row) may have been saved since
+	for (auto editor = this; editor; editor = editor->parent) {
+		editor->dirty = true;
+	}
+}
+
+Array ResourceEditor::get_path() const {
+	std::vector<Variant> keys;
+	for (auto editor = this; editor; editor = editor->parent) {
+		if (editor->key.get_type() != Variant::NIL) {
+			keys.push_back(editor->key);
+		}
+	}
+
+	Array path;
+	for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+		path.append(*it);
+	}
+	return path;
+}
+
+ResourceEditor* ResourceEditor::get_child_editor(const Variant& key) {
+	return nullptr;
+}
+
+void ResourceEditor::read_child(const Variant& key, const Variant& child_value, const Variant& value) {
+	read(value);
+}
+
+void ResourceEditor::set_expanded(bool expanded) {
+}
+
+bool ResourceEditor::_build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec) {
+	return true;
+}
+
 ResourceEditor::ResourceEditor() {
 }
 
 ResourceEditor::~ResourceEditor() {
 }
 
-static std::pair<Control*, ResourceEditor*> create_edit_overloaded(
+/// Creates a collapsed editor for `node`, editors for its children are added by ResourceEditor::_build_children() once expanded
+static std::pair<Control*, ResourceEditor*> create_editor_shell(
 		ResourceInspectorProperty* root,
 		ResourceEditor* parent,
-		const Schema* schema,
+		const CompiledSchema* schema,
+		const SchemaNode* node,
 		const Variant& key,
 		bool add_border = false) {
-	if (auto sch = dynamic_cast<const StructSchema*>(schema)) {
-		auto edit = StructEditor::_new();
-		edit->_custom_init(root, parent, sch, key);
-
-		if (add_border) {
-			auto container = BorderedContainer::_new();
-			container->add_child(edit);
-			return { container, edit };
-		} else {
+	ResourceEditor* editor;
+	switch (node->kind) {
+		case SchemaKind::STRUCT: {
+			auto edit = StructEditor::_new();
+			edit->_custom_init(root, parent, schema, node, key);
+			editor = edit;
+		} break;
+		case SchemaKind::ARRAY: {
+			auto edit = ArrayEditor::_new();
+			edit->_custom_init(root, parent, schema, node, key);
+			editor = edit;
+		} break;
+		case SchemaKind::REF: {
+			auto target = schema->resolve(*node);
+			if (target && !node->ref.recursive) {
+				// Non-recursive references are edited in place, as if the definition was written inline
+				return create_editor_shell(root, parent, schema, target, key, add_border);
+			}
+			if (!target) {
+				// ValueEditor shows unresolved references as an error message
+				auto edit = ValueEditor::_new();
+				edit->_custom_init(root, parent, schema, node, key);
+				return { edit, edit };
+			}
+			auto edit = RefEditor::_new();
+			edit->_custom_init(root, parent, schema, node, key);
+			editor = edit;
+		} break;
+		default: {
+			auto edit = ValueEditor::_new();
+			edit->_custom_init(root, parent, schema, node, key);
 			return { edit, edit };
 		}
-	} else if (auto sch = dynamic_cast<const ArraySchema*>(schema)) {
-		auto edit = ArrayEditor::_new();
-		edit->_custom_init(root, parent, sch, key);
+	}
 
-		if (add_border) {
-			auto container = BorderedContainer::_new();
-			container->add_child(edit);
-			return { container, edit };
-		} else {
-			return { edit, edit };
-		}
+	if (add_border) {
+		auto container = BorderedContainer::_new();
+		container->add_child(editor);
+		return { container, editor };
 	} else {
-		auto edit = ValueEditor::_new();
-		edit->_custom_init(root, parent, schema, key);
-		return { edit, edit };
+		return { editor, editor };
 	}
 }
 
+/// End of a build slice starting now, see get_build_budget()
+static int64_t make_build_deadline() {
+	float budget = get_build_budget();
+	if (budget <= 0) {
+		return INT64_MAX;
+	}
+	return OS::get_singleton()->get_ticks_usec() + static_cast<int64_t>(budget * 1000);
+}
+
 static ResourceEditor* find_editor_from(Node* c) {
 	if (auto container = Object::cast_to<MarginContainer>(c)) {
 		if (container->get_child_count() > 0) {
@@ -96,17 +186,165 @@ static void format_key_to(const Variant& key, Label* label) {
 	}
 }
 
+/// Integral floats may be stored as ints, the validator accepts both for FLOAT fields and so do the editors
+static bool is_number(const Variant& value) {
+	return value.get_type() == Variant::INT || value.get_type() == Variant::REAL;
+}
+
+/// The value saved by a newly created editor for `node`, computed from the schema without creating any editors
+static Variant make_default_value(const CompiledSchema* schema, const SchemaNode* node) {
+	// Dictionary and Array are shared by reference, so containers can be stored in their parent before being filled
+	struct Task {
+		const SchemaNode* node;
+		Variant parent;
+		Variant key;
+	};
+
+	Variant result;
+	std::vector<Task> stack{ { node, Variant{}, Variant{} } };
+	while (!stack.empty()) {
+		auto task = std::move(stack.back());
+		stack.pop_back();
+
+		auto node = task.node;
+		if (node->kind == SchemaKind::REF && !node->ref.recursive) {
+			if (auto target = schema->resolve(*node)) {
+				node = target;
+			}
+		}
+
+		Variant value;
+		switch (node->kind) {
+			case SchemaKind::STRUCT: {
+				Dictionary dict;
+				for (uint32_t i = 0; i < node->count; ++i) {
+					auto& field = schema->get_field(*node, i);
+					stack.push_back({ &schema->get_node(field.node), dict, field.name });
+				}
+				value = dict;
+			} break;
+			case SchemaKind::ARRAY: {
+				Array array;
+				array.resize(node->array.min_elements);
+				for (int i = 0; i < node->array.min_elements; ++i) {
+					stack.push_back({ &schema->get_element_type(*node), array, i });
+				}
+				value = array;
+			} break;
+			case SchemaKind::STRING: value = String{}; break;
+			// OptionButton selects its first item
+			case SchemaKind::ENUM: value = node->count > 0 ? schema->get_enum_value(*node, 0).id : -1; break;
+			// SpinBox clamps its initial value of 0, with the minimum winning over the maximum
+			case SchemaKind::INT: value = std::max(node->int_range.min_value, std::min(0, node->int_range.max_value)); break;
+			case SchemaKind::FLOAT: value = std::max(node->float_range.min_value, std::min(real_t(0), node->float_range.max_value)); break;
+			case SchemaKind::BOOL: value = false; break;
+			// Recursive and unresolved references
+			default: break;
+		}
+
+		switch (task.parent.get_type()) {
+			case Variant::DICTIONARY: {
+				Dictionary dict = task.parent;
+				dict[task.key] = value;
+			} break;
+			case Variant::ARRAY: {
+				Array array = task.parent;
+				array[static_cast<int>(task.key)] = value;
+			} break;
+			default: {
+				result = value;
+			} break;
+		}
+	}
+	return result;
+}
+
+/// One line description of `value` for collapsed editors, e.g. `{ idx: 3, name: "foo", ... }`
+static String summarize_value(const Variant& value) {
+	static const int max_length = 60;
+
+	// Nested containers are only described by their size, to keep this short
+	auto summarize_entry = [](const Variant& entry) -> String {
+		switch (entry.get_type()) {
+			case Variant::DICTIONARY: return "{...}";
+			case Variant::ARRAY: return "[" + String::num_int64(static_cast<Array>(entry).size()) + "]";
+			case Variant::STRING: return "\"" + static_cast<String>(entry) + "\"";
+			case Variant::NIL: return "null";
+			default: return entry;
+		}
+	};
+
+	switch (value.get_type()) {
+		case Variant::DICTIONARY: {
+			const Dictionary dict = value;
+			Array keys = dict.keys();
+			String text = "{ ";
+			for (int i = 0; i < keys.size(); ++i) {
+				if (i > 0) {
+					text += ", ";
+				}
+				if (text.length() > max_length) {
+					text += "...";
+					break;
+				}
+				text += static_cast<String>(keys[i]) + ": " + summarize_entry(dict[keys[i]]);
+			}
+			return text + " }";
+		}
+		case Variant::ARRAY: {
+			int size = static_cast<Array>(value).size();
+			return String::num_int64(size) + (size == 1 ? " element" : " elements");
+		}
+		default: return summarize_entry(value);
+	}
+}
+
 void StructEditor::_notification(int what) {
 	ListContainer::_notification(what);
+	switch (what) {
+		// A pooled editor may have been detached (and its build cancelled) halfway through building
+		case NOTIFICATION_ENTER_TREE: {
+			if (expanded && !built) {
+				root->queue_build(this);
+			}
+		} break;
+	}
 }
 
 Size2 StructEditor::_get_minimum_size() {
 	return ListContainer::_get_minimum_size();
 }
 
+void StructEditor::_post_init() {
+	_update_toolbar();
+}
+
+void StructEditor::_toggle_expanded() {
+	set_expanded(!expanded);
+}
+
+void StructEditor::_update_toolbar() {
+	if (is_inside_tree()) {
+		expand->set_button_icon(get_icon(expanded ? "GuiTreeArrowDown" : "GuiTreeArrowRight", "EditorIcons"));
+	}
+	summary->set_visible(!expanded);
+	if (!expanded) {
+		summary->set_text(summarize_value(save()));
+	}
+}
+
+void StructEditor::_update_progress() {
+	progress->set_visible(expanded && !built);
+	if (expanded && !built) {
+		progress->set_text("Building fields... " + String::num_int64(built_count) + "/" + String::num_int64(node->count));
+	}
+}
+
 void StructEditor::_register_methods() {
 	register_method("_notification", &StructEditor::_notification);
 	register_method("_get_minimum_size", &StructEditor::_get_minimum_size);
+	register_method("_post_init", &StructEditor::_post_init);
+	register_method("_toggle_expanded", &StructEditor::_toggle_expanded);
 }
 
 void StructEditor::_init() {
@@ -115,391 +353,2422 @@ void StructEditor::_init() {
 	toolbar = HBoxContainer::_new();
 	add_child(toolbar);
 
+	expand = Button::_new();
+	expand->set_flat(true);
+	expand->connect("pressed", this, "_toggle_expanded");
+	toolbar->add_child(expand);
 	title = Label::_new();
 	toolbar->add_child(title);
+	summary = Label::_new();
+	summary->set_clip_text(true);
+	summary->set_h_size_flags(Control::SIZE_EXPAND_FILL);
+	toolbar->add_child(summary);
 
 	fields = VBoxContainer::_new();
+	fields->set_visible(false);
 	add_child(fields);
+
+	progress = Label::_new();
+	progress->set_visible(false);
+	add_child(progress);
+
+	call_deferred("_post_init");
 }
 
-void StructEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const StructSchema* schema, const Variant& key) {
+void StructEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key) {
 	this->root = root;
 	this->parent = parent;
 	this->schema = schema;
+	this->node = node;
+	this->key = key;
 
 	format_key_to(key, title);
+	value = make_default_value(schema, node);
+	_update_toolbar();
+}
 
-	for (auto& [name, field] : schema->fields) {
-		fields->add_child(create_edit_overloaded(root, this, field.get(), name).first);
+bool StructEditor::_build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec) {
+	if (!expanded || built) {
+		return true;
 	}
+
+	// See read()
+	const Dictionary dict = value;
+	while (built_count < node->count) {
+		auto& field = schema->get_field(*node, built_count);
+		auto [control, editor] = create_editor_shell(root, this, schema, &schema->get_node(field.node), field.name);
+		fields->add_child(control);
+		editor->read(dict.has(field.name) ? dict[field.name] : Variant{});
+		pending.push_back(editor);
+		++built_count;
+
+		if (OS::get_singleton()->get_ticks_usec() >= deadline_usec) {
+			break;
+		}
+	}
+
+	built = built_count == node->count;
+	if (built) {
+		// The fields hold the value from now on
+		value = Variant{};
+	}
+	_update_progress();
+	return built;
 }
 
 void StructEditor::set_key(const Variant& key) {
+	this->key = key;
 	format_key_to(key, title);
 }
 
 void StructEditor::read(const Variant& value) {
-	if (value.get_type() != Variant::DICTIONARY) {
-		return;
+	mark_dirty();
+	if (!built) {
+		// Fields that aren't built yet read their value from here once they are
+		// Values of the wrong type show up as a fresh struct, see ValueEditor::read()
+		this->value = value.get_type() == Variant::DICTIONARY ? value : make_default_value(schema, node);
+		if (built_count == 0) {
+			_update_toolbar();
+			return;
+		}
 	}
 
-	Dictionary dict = value;
-	int i = 0;
-	for (auto& [name, _] : schema->fields) {
-		Object::cast_to<ResourceEditor>(fields->get_child(i))->read(dict[name]);
-		++i;
+	// Missing fields reset their editor, see ValueEditor::read()
+	// The dictionary belongs to the edited object, so this must not use the non-const operator[] which inserts missing keys
+	const Dictionary dict = value.get_type() == Variant::DICTIONARY ? static_cast<Dictionary>(value) : Dictionary{};
+	for (uint32_t i = 0; i < built_count; ++i) {
+		auto& name = schema->get_field(*node, i).name;
+		Object::cast_to<ResourceEditor>(fields->get_child(i))->read(dict.has(name) ? dict[name] : Variant{});
+	}
+	if (!expanded) {
+		_update_toolbar();
 	}
 }
 
-Variant StructEditor::save() const {
+Variant StructEditor::serialize() const {
+	if (built_count == 0) {
+		return value;
+	}
+
 	Dictionary dict;
-	int i = 0;
-	for (auto& [name, _] : schema->fields) {
+	for (uint32_t i = 0; i < built_count; ++i) {
 		auto field = find_editor_from(fields->get_child(i));
-		dict[name] = field->save();
-		++i;
+		dict[schema->get_field(*node, i).name] = field->save();
+	}
+	// Fields that are still being built
+	const Dictionary pending = value;
+	for (uint32_t i = built_count; i < node->count; ++i) {
+		auto& name = schema->get_field(*node, i).name;
+		if (pending.has(name)) {
+			dict[name] = pending[name];
+		}
 	}
 	return dict;
 }
 
+ResourceEditor* StructEditor::get_child_editor(const Variant& key) {
+	for (uint32_t i = 0; i < built_count; ++i) {
+		if (schema->get_field(*node, i).name == key) {
+			return find_editor_from(fields->get_child(i));
+		}
+	}
+	return nullptr;
+}
+
+void StructEditor::set_expanded(bool expanded) {
+	if (this->expanded == expanded) {
+		return;
+	}
+
+	this->expanded = expanded;
+	if (expanded && !built) {
+		root->queue_build(this);
+	}
+	fields->set_visible(expanded);
+	_update_progress();
+	_update_toolbar();
+}
+
 StructEditor::StructEditor() {
 }
 
 StructEditor::~StructEditor() {
 }
 
-ResourceEditor* ArrayEditor::_get_editor_at(int idx) {
-	if (auto container = Object::cast_to<MarginContainer>(elements->get_child(idx))) {
-		return reinterpret_cast<ResourceEditor*>(container->get_child(0));
-	} else {
-		return nullptr;
+// Height assumed for elements until one of them is measured
+static constexpr float ESTIMATED_ROW_HEIGHT = 32.0F;
+static constexpr float ROW_SEPARATION = 4.0F;
+
+float ArrayEditor::_get_row_height(int idx) const {
+	if (row_heights[idx] >= 0) {
+		return row_heights[idx];
 	}
+	return measured_count > 0 ? measured_height_sum / measured_count : ESTIMATED_ROW_HEIGHT;
 }
 
-void ArrayEditor::_element_gui_input(Ref<InputEvent> event, Control* element) {
-	if (auto mb = Object::cast_to<InputEventMouseButton>(event.ptr())) {
-		if (element->get_global_rect().has_point(get_global_mouse_position())) {
-			selected_idx = element->get_index();
-			remove->set_disabled(false);
-			return;
+void ArrayEditor::_rebuild_offsets() {
+	int count = values.size();
+	row_offsets.resize(count + 1);
+	row_offsets[0] = 0;
+	for (int i = 0; i < count; ++i) {
+		row_offsets[i + 1] = row_offsets[i] + _get_row_height(i) + ROW_SEPARATION;
+	}
+	elements->set_custom_minimum_size({ 0, count > 0 ? row_offsets[count] - ROW_SEPARATION : 0 });
+	offsets_dirty = false;
+}
+
+int ArrayEditor::_acquire_row() {
+	for (size_t i = 0; i < rows.size(); ++i) {
+		if (rows[i].index == -1) {
+			rows[i].control->set_visible(true);
+			return i;
 		}
 	}
+
+	auto [control, editor] = root->acquire_editor(this, &schema->get_element_type(*node), Variant{}, true);
+	control->connect("minimum_size_changed", this, "_queue_update_rows");
+	elements->add_child(control);
+	rows.push_back({ control, editor, -1 });
+	return rows.size() - 1;
 }
 
-void ArrayEditor::_add_element() {
-	int idx = elements->get_child_count();
-	auto element = create_edit_overloaded(root, this, schema->element_type.get(), idx, true).first;
-	element->connect("gui_input", this, "_element_gui_input", Array::make(element));
+void ArrayEditor::_own_values() {
+	if (values_shared) {
+		values = values.duplicate();
+		values_shared = false;
+	}
+}
 
-	elements->add_child(element);
-	if (selected_idx != -1 && selected_idx < elements->get_child_count() - 1) {
-		elements->move_child(element, selected_idx + 1);
-		for (int i = selected_idx + 2; i < elements->get_child_count(); ++i) {
-			_get_editor_at(i)->set_key(i);
+void ArrayEditor::_store_element(int idx, const Variant& element) {
+	// Rows scrolling out of view write back elements that mostly didn't change, which must not cost a copy of the whole array
+	if (values_shared) {
+		if (variant_equals(values[idx], element)) {
+			return;
 		}
+		_own_values();
 	}
+	values[idx] = element;
+}
 
-	if (elements->get_child_count() == schema->max_elements) {
-		add->set_disabled(true);
+void ArrayEditor::_release_row(Row& row, bool sync) {
+	if (sync) {
+		_store_element(row.index, row.editor->save());
 	}
+	row.index = -1;
+	row.control->set_visible(false);
+}
 
-	root->emit_something_changed();
+void ArrayEditor::_release_rows(bool sync) {
+	for (auto& row : rows) {
+		if (row.index != -1) {
+			_release_row(row, sync);
+		}
+	}
 }
 
-void ArrayEditor::_remove_element() {
-	if (selected_idx != -1) {
-		elements->get_child(selected_idx)->free();
-		// The elements after the freed element was moved forward, as we used free() instead of queue_free()
-		for (int i = selected_idx; i < elements->get_child_count(); ++i) {
-			_get_editor_at(i)->set_key(i - 1);
+// Free rows kept by an ArrayEditor beyond the ones it currently needs, the rest go back to the pool for other editors
+static constexpr size_t MAX_SPARE_ROWS = 8;
+
+void ArrayEditor::_return_rows(bool all) {
+	if (!all) {
+		auto free_rows = std::count_if(rows.begin(), rows.end(), [](const Row& row) { return row.index == -1; });
+		if (static_cast<size_t>(free_rows) <= MAX_SPARE_ROWS) {
+			return;
 		}
+	}
 
-		selected_idx = -1;
-		remove->set_disabled(true);
-		if (elements->get_child_count() < schema->max_elements) {
-			add->set_disabled(false);
+	size_t spares = 0;
+	std::vector<Row> kept;
+	for (auto& row : rows) {
+		if (!all && (row.index != -1 || spares++ < MAX_SPARE_ROWS)) {
+			kept.push_back(row);
+			continue;
 		}
 
-		root->emit_something_changed();
+		if (row.index != -1) {
+			_release_row(row, true);
+		}
+		if (auto bordered = Object::cast_to<BorderedContainer>(row.control)) {
+			bordered->set_selected(false);
+		}
+		row.control->disconnect("minimum_size_changed", this, "_queue_update_rows");
+		root->release_editor(row.control, row.editor, &schema->get_element_type(*node));
 	}
+	rows = std::move(kept);
 }
 
-void ArrayEditor::_notification(int what) {
-	ListContainer::_notification(what);
+void ArrayEditor::_queue_update_rows() {
+	if (!update_queued) {
+		update_queued = true;
+		call_deferred("_update_rows");
+	}
 }
 
-Size2 ArrayEditor::_get_minimum_size() {
-	return ListContainer::_get_minimum_size();
-}
+void ArrayEditor::_update_rows() {
+	update_queued = false;
+	if (!is_inside_tree() || !expanded) {
+		return;
+	}
 
-void ArrayEditor::_register_methods() {
-	register_method("_post_init", &ArrayEditor::_post_init);
-	register_method("_notification", &ArrayEditor::_notification);
-	register_method("_get_minimum_size", &ArrayEditor::_get_minimum_size);
-	register_method("_element_gui_input", &ArrayEditor::_element_gui_input);
-	register_method("_add_element", &ArrayEditor::_add_element);
-	register_method("_remove_element", &ArrayEditor::_remove_element);
+	if (!_layout_rows(make_build_deadline())) {
+		// The remaining rows are bound by the property's build job on the next frames
+		root->queue_build(this);
+	}
 }
 
-void ArrayEditor::_init() {
-	set_direction(VERTICAL);
+bool ArrayEditor::_layout_rows(int64_t deadline_usec) {
+	// Binding rows calls read() on their editors, that is not an edit
+	bool was_updating = root->is_updating();
+	root->set_updating(true);
 
-	toolbar = HBoxContainer::_new();
-	add_child(toolbar);
+	if (offsets_dirty) {
+		_rebuild_offsets();
+	}
 
-	title = Label::_new();
-	toolbar->add_child(title);
-	add = Button::_new();
-	add->set_flat(true);
-	add->connect("pressed", this, "_add_element");
-	toolbar->add_child(add);
-	remove = Button::_new();
-	remove->set_flat(true);
-	remove->connect("pressed", this, "_remove_element");
-	toolbar->add_child(remove);
+	// Visible part of `elements` in its own coordinates, with half a screen of margin on both sides so that scrolling doesn't show empty space for a frame
+	auto view = scroll ? scroll->get_global_rect() : get_viewport_rect();
+	float origin = elements->get_global_position().y;
+	float margin = view.size.y / 2;
+	float top = view.position.y - origin - margin;
+	float bottom = view.position.y + view.size.y - origin + margin;
+
+	int count = values.size();
+	int first = std::upper_bound(row_offsets.begin(), row_offsets.end(), top) - row_offsets.begin() - 1;
+	first = std::clamp(first, 0, count);
+	int last = first;
+	while (last < count && row_offsets[last] < bottom) {
+		++last;
+	}
 
-	elements = VBoxContainer::_new();
-	add_child(elements);
+	for (auto& row : rows) {
+		if (row.index != -1 && (row.index < first || row.index >= last)) {
+			_release_row(row, true);
+		}
+	}
 
-	call_deferred("_post_init");
-}
+	std::vector<bool> bound(last - first);
+	for (auto& row : rows) {
+		if (row.index != -1) {
+			bound[row.index - first] = true;
+		}
+	}
+	bool finished = true;
+	bool bound_any = false;
+	for (int i = first; i < last; ++i) {
+		if (bound[i - first]) continue;
+		// Binding at least one row each time makes sure this gets somewhere even with a tiny budget
+		if (bound_any && OS::get_singleton()->get_ticks_usec() >= deadline_usec) {
+			finished = false;
+			break;
+		}
+		bound_any = true;
+
+		auto& row = rows[_acquire_row()];
+		row.index = i;
+		row.editor->set_key(i);
+		// Expanding is per element, not per row
+		row.editor->set_expanded(false);
+		row.editor->read(values[i]);
+		if (auto bordered = Object::cast_to<BorderedContainer>(row.control)) {
+			bordered->set_selected(_is_selected(i));
+		}
+	}
+	_return_rows(false);
+
+	bool resized = false;
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+
+		float height = row.control->get_combined_minimum_size().y;
+		float& measured = row_heights[row.index];
+		if (measured != height) {
+			if (measured < 0) {
+				measured_height_sum += height;
+				++measured_count;
+			} else {
+				measured_height_sum += height - measured;
+			}
+			measured = height;
+			resized = true;
+		}
+	}
+	if (resized) {
+		_rebuild_offsets();
+	}
 
-void ArrayEditor::_post_init() {
-	add->set_button_icon(get_icon("Add", "EditorIcons"));
-	remove->set_button_icon(get_icon("Remove", "EditorIcons"));
-}
+	float width = elements->get_size().x;
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
 
-void ArrayEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const ArraySchema* schema, const Variant& key) {
-	this->root = root;
-	this->parent = parent;
-	this->schema = schema;
+		// Only touch rows that actually moved, so that nested arrays don't get a transform notification for nothing
+		Vector2 position{ 0, row_offsets[row.index] };
+		Vector2 size{ width, row_heights[row.index] };
+		if (row.control->get_position() != position) {
+			row.control->set_position(position);
+		}
+		if (row.control->get_size() != size) {
+			row.control->set_size(size);
+		}
+	}
 
-	format_key_to(key, title);
+	root->set_updating(was_updating);
 
-	for (int i = 0; i < schema->min_elements; ++i) {
-		elements->add_child(create_edit_overloaded(root, this, schema->element_type.get(), i).first);
+	// Different heights move the elements below, which may change what is visible
+	// When unfinished the build job calls this again anyway, on the next frame rather than right away
+	if (resized && finished) {
+		_queue_update_rows();
 	}
+	return finished;
 }
 
-void ArrayEditor::set_key(const Variant& key) {
-	format_key_to(key, title);
-}
-
-void ArrayEditor::read(const Variant& value) {
-	if (value.get_type() != Variant::ARRAY) {
-		return;
+void ArrayEditor::_update_toolbar() {
+	if (is_inside_tree()) {
+		expand->set_button_icon(get_icon(expanded ? "GuiTreeArrowDown" : "GuiTreeArrowRight", "EditorIcons"));
 	}
-
-	Array array = value;
-	for (int i = 0; i < elements->get_child_count(); ++i) {
-		elements->get_child(i)->free();
+	summary->set_visible(!expanded);
+	if (!expanded) {
+		summary->set_text(summarize_value(values));
 	}
-	for (int i = 0; i < array.size(); ++i) {
-		auto [container, editor] = create_edit_overloaded(root, this, schema->element_type.get(), i, true);
-		elements->add_child(container);
-		editor->read(array[i]);
+	add->set_disabled(values.size() >= node->array.max_elements);
+	remove->set_disabled(selection.empty());
+	// Reordering one target's elements would be applied to the others as is, where the same indices are other elements
+	operations->set_disabled(root->has_edit_targets());
+	bulk_bar->set_visible(element_struct && expanded && !selection.empty());
+	if (bulk_bar->is_visible()) {
+		bulk_label->set_text(String::num_int64(selection.size()) + " selected");
 	}
 }
 
-Variant ArrayEditor::save() const {
-	Array array;
-	for (int i = 0; i < elements->get_child_count(); ++i) {
-		auto field = find_editor_from(elements->get_child(i));
-		array.append(field->save());
-	}
-	return array;
+bool ArrayEditor::_is_selected(int idx) const {
+	return std::binary_search(selection.begin(), selection.end(), idx);
 }
 
-ArrayEditor::ArrayEditor() {
+void ArrayEditor::_update_row_selection() {
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+		if (auto bordered = Object::cast_to<BorderedContainer>(row.control)) {
+			bordered->set_selected(_is_selected(row.index));
+		}
+	}
 }
 
-ArrayEditor::~ArrayEditor() {
-}
+void ArrayEditor::_child_clicked(ResourceEditor* child, bool range, bool toggle) {
+	auto it = std::find_if(rows.begin(), rows.end(), [child](const Row& row) { return row.editor == child; });
+	if (it == rows.end() || it->index == -1) {
+		return;
+	}
 
-void ValueEditor::_notification(int what) {
-	ListContainer::_notification(what);
+	int idx = it->index;
+	if (range && selected_idx != -1 && selected_idx < values.size()) {
+		// The element clicked before stays the start of the range
+		int from = std::min<int>(selected_idx, idx);
+		int to = std::max<int>(selected_idx, idx);
+		selection.clear();
+		for (int i = from; i <= to; ++i) {
+			selection.push_back(i);
+		}
+	} else if (toggle) {
+		auto pos = std::lower_bound(selection.begin(), selection.end(), idx);
+		if (pos != selection.end() && *pos == idx) {
+			selection.erase(pos);
+		} else {
+			selection.insert(pos, idx);
+		}
+		selected_idx = idx;
+	} else {
+		selection.assign(1, idx);
+		selected_idx = idx;
+	}
+	_update_row_selection();
+	_update_toolbar();
 }
 
-Size2 ValueEditor::_get_minimum_size() {
-	return ListContainer::_get_minimum_size();
+ResourceEditor* ArrayEditor::get_child_editor(const Variant& key) {
+	if (key.get_type() != Variant::INT) {
+		return nullptr;
+	}
+	for (auto& row : rows) {
+		if (row.index == static_cast<int>(key)) {
+			return row.editor;
+		}
+	}
+	return nullptr;
 }
 
-void ValueEditor::_update_string_value(const String& value) {
-	root->emit_something_changed();
-}
+void ArrayEditor::read_child(const Variant& key, const Variant& child_value, const Variant& value) {
+	// Elements without a row only live in `values`, so this doesn't need to look at the rest of the array
+	if (key.get_type() != Variant::INT || static_cast<int>(key) < 0 || static_cast<int>(key) >= values.size()) {
+		read(value);
+		return;
+	}
 
-void ValueEditor::_update_enum_value(int idx) {
-	root->emit_something_changed();
+	_store_element(key, child_value);
+	mark_dirty();
+	if (!expanded) {
+		_update_toolbar();
+	}
 }
 
-void ValueEditor::_update_int_value(int value) {
-	root->emit_something_changed();
+bool ArrayEditor::_build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec) {
+	// Rows are bound to the visible elements only, the elements themselves don't have editors to build
+	if (!is_inside_tree() || !expanded) {
+		return true;
+	}
+	return _layout_rows(deadline_usec);
 }
 
-void ValueEditor::_update_float_value(float value) {
-	root->emit_something_changed();
-}
+void ArrayEditor::_add_element() {
+	int idx = !selection.empty() ? selection.back() + 1 : values.size();
+	_own_values();
+	values.insert(idx, make_default_value(schema, &schema->get_element_type(*node)));
+	row_heights.insert(row_heights.begin() + idx, -1.0F);
+	// Rows keep their editors, only the elements after the new one get a new index
+	for (auto& row : rows) {
+		if (row.index >= idx) {
+			++row.index;
+			row.editor->set_key(row.index);
+		}
+	}
+	// The selection stays on the same elements
+	for (auto& i : selection) {
+		if (i >= idx) ++i;
+	}
+	if (selected_idx >= idx) {
+		++selected_idx;
+	}
 
-void ValueEditor::_update_bool_value(bool value) {
-	root->emit_something_changed();
-}
+	offsets_dirty = true;
+	mark_dirty();
+	_update_toolbar();
+	_queue_update_rows();
 
-void ValueEditor::_register_methods() {
-	register_method("_notification", &ValueEditor::_notification);
-	register_method("_get_minimum_size", &ValueEditor::_get_minimum_size);
-	register_method("_update_string_value", &ValueEditor::_update_string_value);
-	register_method("_update_enum_value", &ValueEditor::_update_enum_value);
-	register_method("_update_int_value", &ValueEditor::_update_int_value);
-	register_method("_update_float_value", &ValueEditor::_update_float_value);
-	register_method("_update_bool_value", &ValueEditor::_update_bool_value);
+	auto path = get_path();
+	path.append(idx);
+	root->record_edit({ EditDelta::INSERT, path, values[idx] });
 }
 
-void ValueEditor::_init() {
-	set_direction(HORIZONTAL);
-	set_stretching(true);
-}
+void ArrayEditor::_remove_element() {
+	if (selection.empty()) {
+		return;
+	}
 
-void ValueEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const Schema* schema, const Variant& key) {
-	this->root = root;
-	this->parent = parent;
-	this->schema = schema;
+	int count = values.size();
+	std::vector<bool> removed(count);
+	for (int idx : selection) {
+		removed[idx] = true;
+	}
 
-	if (key.get_type() == Variant::STRING) {
-		title = Label::_new();
-		title->set_h_size_flags(Control::SIZE_FILL | Control::SIZE_EXPAND);
-		title->set_text(key);
-		add_child(title);
+	// Rows keep their editors, the elements after a removed one move up by the number of removed elements before them
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+		if (removed[row.index]) {
+			_release_row(row, false);
+		} else {
+			row.index -= std::lower_bound(selection.begin(), selection.end(), row.index) - selection.begin();
+			row.editor->set_key(row.index);
+		}
 	}
 
-	if (auto sch = dynamic_cast<const StringSchema*>(schema)) {
-		// TODO pattern filtering
-		auto edit = LineEdit::_new();
-		this->edit = edit;
-		edit->connect("text_changed", this, "_update_string_value");
-	} else if (auto sch = dynamic_cast<const EnumSchema*>(schema)) {
-		auto edit = OptionButton::_new();
-		this->edit = edit;
-		edit->connect("item_selected", this, "_update_enum_value");
-		for (auto& [name, id] : sch->elements) {
-			edit->get_popup()->add_item(name, id);
-		}
-	} else if (auto sch = dynamic_cast<const IntSchema*>(schema)) {
-		auto edit = SpinBox::_new();
-		this->edit = edit;
-		edit->set_min(sch->min_value);
-		edit->set_max(sch->max_value);
-		edit->connect("value_changed", this, "_update_int_value");
-	} else if (auto sch = dynamic_cast<const FloatSchema*>(schema)) {
-		auto edit = SpinBox::_new();
-		this->edit = edit;
-		edit->set_min(sch->min_value);
-		edit->set_max(sch->max_value);
-		edit->connect("value_changed", this, "_update_float_value");
-	} else if (auto sch = dynamic_cast<const BoolSchema*>(schema)) {
-		auto edit = CheckBox::_new();
-		this->edit = edit;
-		edit->connect("toggled", this, "_update_bool_value");
-	} else {
-		auto edit = Label::_new();
-		this->edit = edit;
-		edit->set_text("Unknown schema type. This is a bug, please report immediately.");
-		ERR_PRINT("Unknown schema type for ValueEditor.");
+	// Removing from the back keeps the indices of the deltas valid, all of them are undone at once
+	auto base_path = get_path();
+	std::vector<EditDelta> deltas;
+	deltas.reserve(selection.size());
+	for (auto it = selection.rbegin(); it != selection.rend(); ++it) {
+		auto path = base_path.duplicate();
+		path.append(*it);
+		deltas.push_back({ EditDelta::REMOVE, path });
 	}
-	edit->set_h_size_flags(Control::SIZE_FILL | Control::SIZE_EXPAND);
-	add_child(edit);
-}
 
-void ValueEditor::set_key(const Variant& key) {
-	if (title) {
-		format_key_to(key, title);
+	// One pass over the elements instead of removing them one by one
+	Array kept;
+	kept.resize(count - selection.size());
+	std::vector<float> kept_heights;
+	kept_heights.reserve(kept.size());
+	for (int i = 0, j = 0; i < count; ++i) {
+		if (!removed[i]) {
+			kept[j++] = values[i];
+			kept_heights.push_back(row_heights[i]);
+		} else if (row_heights[i] >= 0) {
+			measured_height_sum -= row_heights[i];
+			--measured_count;
+		}
+	}
+	values = kept;
+	values_shared = false;
+	row_heights = std::move(kept_heights);
+
+	selection.clear();
+	selected_idx = -1;
+	offsets_dirty = true;
+	mark_dirty();
+	_update_toolbar();
+	_queue_update_rows();
+
+	if (deltas.size() == 1) {
+		root->record_edit(std::move(deltas.front()));
+	} else {
+		root->record_edits(std::move(deltas));
+	}
+}
+
+/// Converts the text typed into the bulk edit bar to a value of the scalar `node`, returns false if it isn't one
+static bool parse_scalar_value(const CompiledSchema* schema, const SchemaNode* node, const String& text, Variant& value) {
+	auto stripped = text.strip_edges();
+	switch (node->kind) {
+		case SchemaKind::STRING: {
+			value = text;
+		} break;
+		case SchemaKind::ENUM: {
+			// By name, or by id
+			for (uint32_t i = 0; i < node->count; ++i) {
+				auto& enum_value = schema->get_enum_value(*node, i);
+				if (enum_value.name == stripped || (stripped.is_valid_integer() && enum_value.id == stripped.to_int())) {
+					value = enum_value.id;
+					return true;
+				}
+			}
+			return false;
+		}
+		case SchemaKind::INT: {
+			if (!stripped.is_valid_integer()) {
+				return false;
+			}
+			value = std::clamp(stripped.to_int(), node->int_range.min_value, node->int_range.max_value);
+		} break;
+		case SchemaKind::FLOAT: {
+			if (!stripped.is_valid_float()) {
+				return false;
+			}
+			value = std::clamp(static_cast<real_t>(stripped.to_float()), node->float_range.min_value, node->float_range.max_value);
+		} break;
+		case SchemaKind::BOOL: {
+			auto lower = stripped.to_lower();
+			if (lower == "true" || lower == "1") {
+				value = true;
+			} else if (lower == "false" || lower == "0") {
+				value = false;
+			} else {
+				return false;
+			}
+		} break;
+		default: return false;
+	}
+	return true;
+}
+
+static bool is_bulk_editable(SchemaKind kind) {
+	switch (kind) {
+		case SchemaKind::STRING:
+		case SchemaKind::ENUM:
+		case SchemaKind::INT:
+		case SchemaKind::FLOAT:
+		case SchemaKind::BOOL:
+			return true;
+		default:
+			return false;
+	}
+}
+
+void ArrayEditor::_setup_bulk_fields() {
+	bulk_field->clear();
+	element_struct = nullptr;
+
+	// Recursive references may be nil, creating them is left to their own editor
+	auto& element_type = schema->get_element_type(*node);
+	if (element_type.kind == SchemaKind::REF && element_type.ref.recursive) {
+		return;
+	}
+	auto element = schema->resolve(element_type);
+	if (!element || element->kind != SchemaKind::STRUCT) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < element->count; ++i) {
+		auto field_node = schema->resolve(schema->get_field_node(*element, i));
+		if (field_node && is_bulk_editable(field_node->kind)) {
+			bulk_field->add_item(schema->get_field(*element, i).name, i);
+		}
+	}
+	if (bulk_field->get_item_count() > 0) {
+		element_struct = element;
+		_bulk_field_selected(0);
+	}
+}
+
+void ArrayEditor::_bulk_field_selected(int idx) {
+	auto field_node = schema->resolve(schema->get_field_node(*element_struct, bulk_field->get_item_id(idx)));
+	bulk_offset->set_disabled(field_node->kind != SchemaKind::INT && field_node->kind != SchemaKind::FLOAT);
+}
+
+void ArrayEditor::_bulk_set() {
+	_bulk_apply(BULK_SET);
+}
+
+void ArrayEditor::_bulk_offset() {
+	_bulk_apply(BULK_OFFSET);
+}
+
+void ArrayEditor::_bulk_clear() {
+	_bulk_apply(BULK_CLEAR);
+}
+
+void ArrayEditor::_bulk_apply(BulkOperation operation) {
+	if (!element_struct || selection.empty() || bulk_field->get_selected() == -1) {
+		return;
+	}
+
+	auto& field = schema->get_field(*element_struct, bulk_field->get_selected_id());
+	auto field_node = schema->resolve(schema->get_node(field.node));
+	auto text = bulk_value->get_text();
+	Variant operand;
+	switch (operation) {
+		case BULK_SET: {
+			if (!parse_scalar_value(schema, field_node, text, operand)) {
+				bulk_label->set_text("Not a valid value for " + field.name);
+				return;
+			}
+		} break;
+		case BULK_OFFSET: {
+			auto stripped = text.strip_edges();
+			bool valid = field_node->kind == SchemaKind::INT ? stripped.is_valid_integer() : stripped.is_valid_float();
+			if (!valid) {
+				bulk_label->set_text("Not a valid offset for " + field.name);
+				return;
+			}
+			operand = field_node->kind == SchemaKind::INT ? Variant{ stripped.to_int() } : Variant{ stripped.to_float() };
+		} break;
+		case BULK_CLEAR: {
+			operand = make_default_value(schema, field_node);
+		} break;
+	}
+
+	// Selected elements that have a row are only up to date in the row's editor
+	for (auto& row : rows) {
+		if (row.index != -1 && _is_selected(row.index)) {
+			_store_element(row.index, row.editor->save());
+		}
+	}
+
+	auto base_path = get_path();
+	std::vector<EditDelta> deltas;
+	deltas.reserve(selection.size());
+	for (int idx : selection) {
+		// Elements share their dictionaries with the edited value, which only the edit history may modify
+		Dictionary element = values[idx].get_type() == Variant::DICTIONARY
+				? static_cast<Dictionary>(values[idx]).duplicate()
+				: static_cast<Dictionary>(make_default_value(schema, element_struct));
+
+		Variant result = operand;
+		if (operation == BULK_OFFSET) {
+			const Dictionary& current = element;
+			Variant old = current.has(field.name) ? current[field.name] : Variant{};
+			if (field_node->kind == SchemaKind::INT) {
+				// In 64 bits, so that neither a stored value outside the range nor a large offset can overflow before clamping
+				int64_t min_value = field_node->int_range.min_value;
+				int64_t max_value = field_node->int_range.max_value;
+				int64_t base = old.get_type() == Variant::INT ? static_cast<int64_t>(old) : static_cast<int64_t>(make_default_value(schema, field_node));
+				int64_t offset = std::clamp(static_cast<int64_t>(operand), min_value - max_value, max_value - min_value);
+				result = std::clamp(std::clamp(base, min_value, max_value) + offset, min_value, max_value);
+			} else {
+				double base = is_number(old) ? static_cast<double>(old) : static_cast<double>(make_default_value(schema, field_node));
+				result = std::clamp(base + static_cast<double>(operand), static_cast<double>(field_node->float_range.min_value), static_cast<double>(field_node->float_range.max_value));
+			}
+		}
+		element[field.name] = result;
+		_store_element(idx, element);
+
+		auto path = base_path.duplicate();
+		path.append(idx);
+		path.append(field.name);
+		deltas.push_back({ EditDelta::SET, path, result });
+	}
+
+	// Reading the new values into the rows is not an edit of its own
+	bool was_updating = root->is_updating();
+	root->set_updating(true);
+	for (auto& row : rows) {
+		if (row.index != -1 && _is_selected(row.index)) {
+			row.editor->read(values[row.index]);
+		}
+	}
+	root->set_updating(was_updating);
+
+	mark_dirty();
+	_update_toolbar();
+	root->record_edits(std::move(deltas));
+}
+
+void ArrayEditor::_setup_operations() {
+	operation_keys.clear();
+	if (element_struct) {
+		for (int i = 0; i < bulk_field->get_item_count(); ++i) {
+			operation_keys.push_back(schema->get_field(*element_struct, bulk_field->get_item_id(i)).name);
+		}
+	} else if (auto element = schema->resolve(schema->get_element_type(*node)); element && is_bulk_editable(element->kind)) {
+		operation_keys.push_back(Variant{});
+	}
+
+	auto popup = operations->get_popup();
+	popup->clear();
+	for (size_t i = 0; i < operation_keys.size(); ++i) {
+		auto& key = operation_keys[i];
+		String suffix = key.get_type() == Variant::NIL ? String{} : " by " + static_cast<String>(key);
+		int base = i * OPERATION_COUNT;
+		popup->add_item("Sort" + suffix + " (Ascending)", base + OPERATION_SORT_ASCENDING);
+		popup->add_item("Sort" + suffix + " (Descending)", base + OPERATION_SORT_DESCENDING);
+		popup->add_item("Remove Duplicates" + suffix, base + OPERATION_DEDUPE);
+	}
+	if (!operation_keys.empty()) {
+		popup->add_separator();
+	}
+	popup->add_item("Move Up", OPERATION_MOVE_UP);
+	popup->add_item("Move Down", OPERATION_MOVE_DOWN);
+	popup->add_item("Move to Top", OPERATION_MOVE_TOP);
+	popup->add_item("Move to Bottom", OPERATION_MOVE_BOTTOM);
+	popup->add_item("Move to Index...", OPERATION_MOVE_TO);
+}
+
+void ArrayEditor::_operations_about_to_show() {
+	auto popup = operations->get_popup();
+	for (int op = OPERATION_MOVE_UP; op <= OPERATION_MOVE_TO; ++op) {
+		popup->set_item_disabled(popup->get_item_index(op), selection.empty());
+	}
+}
+
+void ArrayEditor::_operation_pressed(int id) {
+	size_t slot = id / OPERATION_COUNT;
+	Variant key = slot < operation_keys.size() ? operation_keys[slot] : Variant{};
+	switch (id % OPERATION_COUNT) {
+		case OPERATION_SORT_ASCENDING: {
+			sort_elements({ SortKey{ key, false } });
+		} break;
+		case OPERATION_SORT_DESCENDING: {
+			sort_elements({ SortKey{ key, true } });
+		} break;
+		case OPERATION_DEDUPE: {
+			dedupe_elements(key);
+		} break;
+		case OPERATION_MOVE_UP: {
+			move_selection(-1);
+		} break;
+		case OPERATION_MOVE_DOWN: {
+			move_selection(1);
+		} break;
+		case OPERATION_MOVE_TOP: {
+			move_selection_to(0);
+		} break;
+		case OPERATION_MOVE_BOTTOM: {
+			move_selection_to(values.size());
+		} break;
+		case OPERATION_MOVE_TO: {
+			move_index->set_max(std::max<int>(values.size() - selection.size(), 0));
+			move_index->set_value(selection.empty() ? 0 : selection.front());
+			move_dialog->popup_centered();
+		} break;
+	}
+}
+
+void ArrayEditor::_move_dialog_confirmed() {
+	move_selection_to(static_cast<int>(move_index->get_value()));
+}
+
+void ArrayEditor::_reorder(const std::vector<int>& order) {
+	// Rows are about to show other elements, `values` has to be up to date for all of them
+	for (auto& row : rows) {
+		if (row.index != -1) {
+			_store_element(row.index, row.editor->save());
+		}
+	}
+
+	int count = values.size();
+	std::vector<int> new_index(count, -1);
+	Array reordered;
+	reordered.resize(order.size());
+	std::vector<float> heights(order.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		reordered[i] = values[order[i]];
+		heights[i] = row_heights[order[i]];
+		new_index[order[i]] = i;
+	}
+	for (int i = 0; i < count; ++i) {
+		if (new_index[i] == -1 && row_heights[i] >= 0) {
+			measured_height_sum -= row_heights[i];
+			--measured_count;
+		}
+	}
+
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+		if (new_index[row.index] == -1) {
+			_release_row(row, false);
+		} else if (new_index[row.index] != row.index) {
+			row.index = new_index[row.index];
+			row.editor->set_key(row.index);
+		}
+	}
+
+	std::vector<int> moved_selection;
+	for (int idx : selection) {
+		if (new_index[idx] != -1) {
+			moved_selection.push_back(new_index[idx]);
+		}
+	}
+	std::sort(moved_selection.begin(), moved_selection.end());
+	selection = std::move(moved_selection);
+	selected_idx = selected_idx != -1 && selected_idx < count ? new_index[selected_idx] : -1;
+
+	values = reordered;
+	values_shared = false;
+	row_heights = std::move(heights);
+	offsets_dirty = true;
+	mark_dirty();
+	_update_row_selection();
+	_update_toolbar();
+	_queue_update_rows();
+}
+
+void ArrayEditor::_record_reorder(int moved_from, int moved_to) {
+	if (moved_from != -1) {
+		auto path = get_path();
+		path.append(moved_from);
+		EditDelta delta{ EditDelta::MOVE, path };
+		delta.to = moved_to;
+		root->record_edit(std::move(delta));
+	} else {
+		// Elements are shared with the previous array, so this only stores references to them
+		root->record_edit({ EditDelta::SET, get_path(), save() });
+	}
+}
+
+/// The field of `element` that is compared when sorting, or the element itself if `field` is nil
+static Variant get_sort_key(const Variant& element, const Variant& field) {
+	if (field.get_type() == Variant::NIL) {
+		return element;
+	}
+	if (element.get_type() != Variant::DICTIONARY) {
+		return Variant{};
+	}
+	const Dictionary dict = element;
+	return dict.has(field) ? dict[field] : Variant{};
+}
+
+/// Orders values of different types by type (nil first), and values of the scalar types that schemas use by value
+static int compare_sort_keys(const Variant& a, const Variant& b) {
+	if (a.get_type() != b.get_type()) {
+		return a.get_type() < b.get_type() ? -1 : 1;
+	}
+	switch (a.get_type()) {
+		case Variant::BOOL: {
+			return static_cast<int>(static_cast<bool>(a)) - static_cast<int>(static_cast<bool>(b));
+		}
+		case Variant::INT: {
+			int64_t x = a;
+			int64_t y = b;
+			return (x > y) - (x < y);
+		}
+		case Variant::REAL: {
+			double x = a;
+			double y = b;
+			return (x > y) - (x < y);
+		}
+		case Variant::STRING: {
+			String x = a;
+			String y = b;
+			return x < y ? -1 : (y < x ? 1 : 0);
+		}
+		default: return 0;
+	}
+}
+
+void ArrayEditor::sort_elements(const std::vector<SortKey>& keys) {
+	int count = values.size();
+	if (keys.empty() || count < 2) {
+		return;
+	}
+
+	// Rows hold the latest value of their element
+	for (auto& row : rows) {
+		if (row.index != -1) {
+			_store_element(row.index, row.editor->save());
+		}
+	}
+	// Extracted once, so that comparing doesn't look up dictionaries
+	std::vector<std::vector<Variant>> columns(keys.size());
+	for (size_t k = 0; k < keys.size(); ++k) {
+		columns[k].reserve(count);
+		for (int i = 0; i < count; ++i) {
+			columns[k].push_back(get_sort_key(values[i], keys[k].field));
+		}
+	}
+
+	std::vector<int> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&keys, &columns](int a, int b) {
+		for (size_t k = 0; k < keys.size(); ++k) {
+			int result = compare_sort_keys(columns[k][a], columns[k][b]);
+			if (result != 0) {
+				return keys[k].descending ? result > 0 : result < 0;
+			}
+		}
+		return false;
+	});
+	if (std::is_sorted(order.begin(), order.end())) {
+		return;
+	}
+
+	_reorder(order);
+	_record_reorder(-1, -1);
+}
+
+void ArrayEditor::dedupe_elements(const Variant& field) {
+	int count = values.size();
+	if (count < 2) {
+		return;
+	}
+
+	for (auto& row : rows) {
+		if (row.index != -1) {
+			_store_element(row.index, row.editor->save());
+		}
+	}
+	std::vector<Variant> column;
+	column.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		column.push_back(get_sort_key(values[i], field));
+	}
+
+	// Equal values end up next to each other, in their original order, so the first of each run is the one to keep
+	std::vector<int> sorted(count);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	std::stable_sort(sorted.begin(), sorted.end(), [&column](int a, int b) { return compare_sort_keys(column[a], column[b]) < 0; });
+	std::vector<bool> duplicate(count);
+	for (int i = 1; i < count; ++i) {
+		if (compare_sort_keys(column[sorted[i - 1]], column[sorted[i]]) == 0) {
+			duplicate[sorted[i]] = true;
+		}
+	}
+
+	std::vector<int> order;
+	for (int i = 0; i < count; ++i) {
+		if (!duplicate[i]) {
+			order.push_back(i);
+		}
+	}
+	if (static_cast<int>(order.size()) == count) {
+		return;
+	}
+
+	_reorder(order);
+	_record_reorder(-1, -1);
+}
+
+void ArrayEditor::move_selection(int offset) {
+	int count = values.size();
+	if (selection.empty()) {
+		return;
+	}
+
+	std::vector<bool> selected(count);
+	for (int idx : selection) {
+		selected[idx] = true;
+	}
+	std::vector<int> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	if (offset < 0) {
+		for (int i = 1; i < count; ++i) {
+			if (selected[order[i]] && !selected[order[i - 1]]) {
+				std::swap(order[i], order[i - 1]);
+			}
+		}
+	} else {
+		for (int i = count - 2; i >= 0; --i) {
+			if (selected[order[i]] && !selected[order[i + 1]]) {
+				std::swap(order[i], order[i + 1]);
+			}
+		}
+	}
+	if (std::is_sorted(order.begin(), order.end())) {
+		return;
+	}
+
+	int from = selection.size() == 1 ? selection.front() : -1;
+	_reorder(order);
+	_record_reorder(from, from != -1 ? selection.front() : -1);
+}
+
+void ArrayEditor::move_selection_to(int index) {
+	int count = values.size();
+	if (selection.empty()) {
+		return;
+	}
+
+	std::vector<bool> selected(count);
+	for (int idx : selection) {
+		selected[idx] = true;
+	}
+	std::vector<int> others;
+	others.reserve(count - selection.size());
+	for (int i = 0; i < count; ++i) {
+		if (!selected[i]) {
+			others.push_back(i);
+		}
+	}
+
+	index = std::clamp(index, 0, static_cast<int>(others.size()));
+	std::vector<int> order(others.begin(), others.begin() + index);
+	order.insert(order.end(), selection.begin(), selection.end());
+	order.insert(order.end(), others.begin() + index, others.end());
+	if (std::is_sorted(order.begin(), order.end())) {
+		return;
+	}
+
+	int from = selection.size() == 1 ? selection.front() : -1;
+	_reorder(order);
+	_record_reorder(from, from != -1 ? selection.front() : -1);
+}
+
+void ArrayEditor::_notification(int what) {
+	ListContainer::_notification(what);
+	switch (what) {
+		case NOTIFICATION_ENTER_TREE: {
+			scroll = nullptr;
+			for (auto p = get_parent(); p; p = p->get_parent()) {
+				if (auto sc = Object::cast_to<ScrollContainer>(p)) {
+					scroll = sc;
+					break;
+				}
+			}
+			_queue_update_rows();
+		} break;
+		case NOTIFICATION_EXIT_TREE: {
+			scroll = nullptr;
+		} break;
+		// Sent for scrolling, and for the layout above this editor changing, both of which can change what is visible
+		case NOTIFICATION_TRANSFORM_CHANGED:
+		case NOTIFICATION_RESIZED: {
+			_queue_update_rows();
+		} break;
+	}
+}
+
+Size2 ArrayEditor::_get_minimum_size() {
+	return ListContainer::_get_minimum_size();
+}
+
+void ArrayEditor::_register_methods() {
+	register_method("_post_init", &ArrayEditor::_post_init);
+	register_method("_notification", &ArrayEditor::_notification);
+	register_method("_get_minimum_size", &ArrayEditor::_get_minimum_size);
+	register_method("_add_element", &ArrayEditor::_add_element);
+	register_method("_remove_element", &ArrayEditor::_remove_element);
+	register_method("_operations_about_to_show", &ArrayEditor::_operations_about_to_show);
+	register_method("_operation_pressed", &ArrayEditor::_operation_pressed);
+	register_method("_move_dialog_confirmed", &ArrayEditor::_move_dialog_confirmed);
+	register_method("_bulk_field_selected", &ArrayEditor::_bulk_field_selected);
+	register_method("_bulk_set", &ArrayEditor::_bulk_set);
+	register_method("_bulk_offset", &ArrayEditor::_bulk_offset);
+	register_method("_bulk_clear", &ArrayEditor::_bulk_clear);
+	register_method("_toggle_expanded", &ArrayEditor::_toggle_expanded);
+	register_method("_queue_update_rows", &ArrayEditor::_queue_update_rows);
+	register_method("_update_rows", &ArrayEditor::_update_rows);
+}
+
+void ArrayEditor::_init() {
+	set_direction(VERTICAL);
+	set_notify_transform(true);
+
+	toolbar = HBoxContainer::_new();
+	add_child(toolbar);
+
+	expand = Button::_new();
+	expand->set_flat(true);
+	expand->connect("pressed", this, "_toggle_expanded");
+	toolbar->add_child(expand);
+	title = Label::_new();
+	toolbar->add_child(title);
+	summary = Label::_new();
+	summary->set_clip_text(true);
+	summary->set_h_size_flags(Control::SIZE_EXPAND_FILL);
+	toolbar->add_child(summary);
+	operations = MenuButton::_new();
+	operations->set_flat(true);
+	operations->set_tooltip("Sort, remove duplicates or move elements");
+	operations->get_popup()->connect("about_to_show", this, "_operations_about_to_show");
+	operations->get_popup()->connect("id_pressed", this, "_operation_pressed");
+	toolbar->add_child(operations);
+	add = Button::_new();
+	add->set_flat(true);
+	add->connect("pressed", this, "_add_element");
+	toolbar->add_child(add);
+	remove = Button::_new();
+	remove->set_flat(true);
+	remove->connect("pressed", this, "_remove_element");
+	toolbar->add_child(remove);
+
+	bulk_bar = HBoxContainer::_new();
+	bulk_bar->set_visible(false);
+	add_child(bulk_bar);
+	bulk_label = Label::_new();
+	bulk_bar->add_child(bulk_label);
+	bulk_field = OptionButton::_new();
+	bulk_field->connect("item_selected", this, "_bulk_field_selected");
+	bulk_bar->add_child(bulk_field);
+	bulk_value = LineEdit::_new();
+	bulk_value->set_placeholder("Value");
+	bulk_value->set_h_size_flags(Control::SIZE_EXPAND_FILL);
+	bulk_bar->add_child(bulk_value);
+	auto bulk_set = Button::_new();
+	bulk_set->set_text("Set");
+	bulk_set->connect("pressed", this, "_bulk_set");
+	bulk_bar->add_child(bulk_set);
+	bulk_offset = Button::_new();
+	bulk_offset->set_text("Offset");
+	bulk_offset->connect("pressed", this, "_bulk_offset");
+	bulk_bar->add_child(bulk_offset);
+	auto bulk_clear = Button::_new();
+	bulk_clear->set_text("Clear");
+	bulk_clear->connect("pressed", this, "_bulk_clear");
+	bulk_bar->add_child(bulk_clear);
+
+	elements = Control::_new();
+	elements->set_mouse_filter(MOUSE_FILTER_PASS);
+	elements->set_visible(false);
+	add_child(elements);
+
+	// Under `elements` because ListContainer would lay it out like the other children
+	move_dialog = AcceptDialog::_new();
+	move_dialog->set_title("Move Selected Elements");
+	move_dialog->connect("confirmed", this, "_move_dialog_confirmed");
+	move_index = SpinBox::_new();
+	move_index->set_prefix("To index");
+	move_dialog->add_child(move_index);
+	move_dialog->register_text_enter(move_index->get_line_edit());
+	elements->add_child(move_dialog);
+
+	call_deferred("_post_init");
+}
+
+void ArrayEditor::_post_init() {
+	operations->set_button_icon(get_icon("Tools", "EditorIcons"));
+	add->set_button_icon(get_icon("Add", "EditorIcons"));
+	remove->set_button_icon(get_icon("Remove", "EditorIcons"));
+	_update_toolbar();
+}
+
+void ArrayEditor::_toggle_expanded() {
+	set_expanded(!expanded);
+}
+
+void ArrayEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key) {
+	this->root = root;
+	this->parent = parent;
+	this->schema = schema;
+	this->node = node;
+	this->key = key;
+
+	format_key_to(key, title);
+
+	values = make_default_value(schema, node);
+	values_shared = false;
+	row_heights.assign(values.size(), -1.0F);
+	_setup_bulk_fields();
+	_setup_operations();
+	_update_toolbar();
+}
+
+void ArrayEditor::set_key(const Variant& key) {
+	this->key = key;
+	format_key_to(key, title);
+}
+
+void ArrayEditor::read(const Variant& value) {
+	mark_dirty();
+	// The edited array is kept as is, elements written back by recycled rows must not modify it so it is only copied once that happens
+	bool shared = value.get_type() == Variant::ARRAY;
+	Array array = shared ? static_cast<Array>(value) : static_cast<Array>(make_default_value(schema, node));
+	int count = array.size();
+
+	// Reconcile with the existing rows instead of rebuilding them: rows past the new end are freed up, and the others only read their element if it differs from what they show
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+
+		if (row.index >= count) {
+			_release_row(row, false);
+		} else if (!variant_equals(row.editor->save(), array[row.index])) {
+			row.editor->read(array[row.index]);
+		}
+	}
+
+	// Heights of the remaining elements are kept, they get measured again when they have a row
+	for (int i = count; i < static_cast<int>(row_heights.size()); ++i) {
+		if (row_heights[i] >= 0) {
+			measured_height_sum -= row_heights[i];
+			--measured_count;
+		}
+	}
+	if (count != values.size()) {
+		offsets_dirty = true;
+	}
+	row_heights.resize(count, -1.0F);
+	values = array;
+	values_shared = shared;
+
+	if (selected_idx >= count) {
+		selected_idx = -1;
+	}
+	selection.erase(std::lower_bound(selection.begin(), selection.end(), count), selection.end());
+	_update_toolbar();
+	_queue_update_rows();
+}
+
+Variant ArrayEditor::serialize() const {
+	// Only copied if a row shows changes that `values` doesn't have yet, otherwise `values` itself is returned and becomes shared
+	Array array = values;
+	bool copied = false;
+	for (auto& row : rows) {
+		if (row.index == -1) continue;
+
+		auto element = row.editor->save();
+		if (!copied) {
+			if (variant_equals(array[row.index], element)) continue;
+			array = values.duplicate();
+			copied = true;
+		}
+		array[row.index] = element;
+	}
+	if (!copied) {
+		values_shared = true;
+	}
+	return array;
+}
+
+void ArrayEditor::set_expanded(bool expanded) {
+	if (this->expanded == expanded) {
+		return;
+	}
+
+	this->expanded = expanded;
+	elements->set_visible(expanded);
+	if (expanded) {
+		_queue_update_rows();
+	} else {
+		_return_rows(true);
+	}
+	_update_toolbar();
+}
+
+ArrayEditor::ArrayEditor() {
+}
+
+ArrayEditor::~ArrayEditor() {
+}
+
+void ValueEditor::_notification(int what) {
+	ListContainer::_notification(what);
+}
+
+Size2 ValueEditor::_get_minimum_size() {
+	return ListContainer::_get_minimum_size();
+}
+
+void ValueEditor::_update_string_value(const String& value) {
+	_set_mixed(false);
+	_update_pattern_hint(value);
+	mark_dirty();
+	root->record_edit({ EditDelta::SET, get_path(), save() });
+}
+
+void ValueEditor::_update_enum_value(int idx) {
+	_set_mixed(false);
+	mark_dirty();
+	root->record_edit({ EditDelta::SET, get_path(), save() });
+}
+
+void ValueEditor::_update_int_value(int value) {
+	_set_mixed(false);
+	mark_dirty();
+	root->record_edit({ EditDelta::SET, get_path(), save() });
+}
+
+void ValueEditor::_update_float_value(float value) {
+	_set_mixed(false);
+	mark_dirty();
+	root->record_edit({ EditDelta::SET, get_path(), save() });
+}
+
+void ValueEditor::_update_bool_value(bool value) {
+	_set_mixed(false);
+	mark_dirty();
+	root->record_edit({ EditDelta::SET, get_path(), save() });
+}
+
+void ValueEditor::_text_entered(const String& text) {
+	root->flush_changes();
+}
+
+void ValueEditor::_focus_exited() {
+	root->flush_changes();
+}
+
+void ValueEditor::_set_mixed(bool mixed) {
+	if (this->mixed == mixed) {
+		return;
+	}
+	this->mixed = mixed;
+	// The title if there is one, the value itself otherwise (e.g. an array element)
+	Control* label = title ? static_cast<Control*>(title) : edit;
+	label->set_self_modulate(mixed ? get_color("warning_color", "Editor") : Color{ 1, 1, 1 });
+	edit->set_tooltip(mixed ? "The selected objects have different values, the first one's is shown" : "");
+}
+
+void ValueEditor::_update_pattern_hint(const String& value) {
+	auto pattern = schema->get_pattern(*node);
+	if (!pattern) {
+		return;
+	}
+
+	bool matches = pattern->matches(value);
+	edit->add_color_override("font_color", matches ? get_color("font_color", "LineEdit") : get_color("error_color", "Editor"));
+}
+
+void ValueEditor::_register_methods() {
+	register_method("_notification", &ValueEditor::_notification);
+	register_method("_get_minimum_size", &ValueEditor::_get_minimum_size);
+	register_method("_update_string_value", &ValueEditor::_update_string_value);
+	register_method("_update_enum_value", &ValueEditor::_update_enum_value);
+	register_method("_update_int_value", &ValueEditor::_update_int_value);
+	register_method("_update_float_value", &ValueEditor::_update_float_value);
+	register_method("_update_bool_value", &ValueEditor::_update_bool_value);
+	register_method("_text_entered", &ValueEditor::_text_entered);
+	register_method("_focus_exited", &ValueEditor::_focus_exited);
+}
+
+void ValueEditor::_init() {
+	set_direction(HORIZONTAL);
+	set_stretching(true);
+}
+
+void ValueEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key) {
+	this->root = root;
+	this->parent = parent;
+	this->schema = schema;
+	this->node = node;
+	this->key = key;
+
+	if (key.get_type() == Variant::STRING) {
+		title = Label::_new();
+		title->set_h_size_flags(Control::SIZE_FILL | Control::SIZE_EXPAND);
+		title->set_text(key);
+		add_child(title);
+	}
+
+	switch (node->kind) {
+		case SchemaKind::STRING: {
+			auto edit = LineEdit::_new();
+			this->edit = edit;
+			edit->connect("text_changed", this, "_update_string_value");
+			edit->connect("text_entered", this, "_text_entered");
+			edit->connect("focus_exited", this, "_focus_exited");
+		} break;
+		case SchemaKind::ENUM: {
+			auto edit = OptionButton::_new();
+			this->edit = edit;
+			edit->connect("item_selected", this, "_update_enum_value");
+			for (uint32_t i = 0; i < node->count; ++i) {
+				auto& [name, id] = schema->get_enum_value(*node, i);
+				edit->get_popup()->add_item(name, id);
+			}
+		} break;
+		case SchemaKind::INT: {
+			auto edit = SpinBox::_new();
+			this->edit = edit;
+			edit->set_min(node->int_range.min_value);
+			edit->set_max(node->int_range.max_value);
+			edit->connect("value_changed", this, "_update_int_value");
+			edit->get_line_edit()->connect("focus_exited", this, "_focus_exited");
+		} break;
+		case SchemaKind::FLOAT: {
+			auto edit = SpinBox::_new();
+			this->edit = edit;
+			edit->set_min(node->float_range.min_value);
+			edit->set_max(node->float_range.max_value);
+			edit->connect("value_changed", this, "_update_float_value");
+			edit->get_line_edit()->connect("focus_exited", this, "_focus_exited");
+		} break;
+		case SchemaKind::BOOL: {
+			auto edit = CheckBox::_new();
+			this->edit = edit;
+			edit->connect("toggled", this, "_update_bool_value");
+		} break;
+		case SchemaKind::REF: {
+			auto edit = Label::_new();
+			this->edit = edit;
+			edit->set_text("Unresolved reference to definition " + schema->get_ref_name(*node));
+		} break;
+		default: {
+			auto edit = Label::_new();
+			this->edit = edit;
+			edit->set_text("Unknown schema type. This is a bug, please report immediately.");
+			ERR_PRINT("Unknown schema type for ValueEditor.");
+		} break;
+	}
+	edit->set_h_size_flags(Control::SIZE_FILL | Control::SIZE_EXPAND);
+	add_child(edit);
+}
+
+void ValueEditor::set_key(const Variant& key) {
+	this->key = key;
+	if (title) {
+		format_key_to(key, title);
 	}
 }
 
 void ValueEditor::read(const Variant& value) {
-	if (auto sch = dynamic_cast<const StringSchema*>(schema) && value.get_type() == Variant::STRING) {
-		Object::cast_to<LineEdit>(edit)->set_text(value);
-	} else if (auto sch = dynamic_cast<const EnumSchema*>(schema) && value.get_type() == Variant::INT) {
-		Object::cast_to<OptionButton>(edit)->select(value);
-	} else if (auto sch = dynamic_cast<const IntSchema*>(schema) && value.get_type() == Variant::INT) {
-		Object::cast_to<SpinBox>(edit)->set_value(value);
-	} else if (auto sch = dynamic_cast<const FloatSchema*>(schema) && value.get_type() == Variant::REAL) {
-		Object::cast_to<SpinBox>(edit)->set_value(value);
-	} else if (auto sch = dynamic_cast<const BoolSchema*>(schema) && value.get_type() == Variant::BOOL) {
-		Object::cast_to<OptionButton>(edit)->select(value ? 1 : 0);
-	}
-}
-
-Variant ValueEditor::save() const {
-	if (auto sch = dynamic_cast<const StringSchema*>(schema)) {
-		return Object::cast_to<LineEdit>(edit)->get_text();
-	} else if (auto sch = dynamic_cast<const EnumSchema*>(schema)) {
-		return Object::cast_to<OptionButton>(edit)->get_selected_id();
-	} else if (auto sch = dynamic_cast<const IntSchema*>(schema)) {
-		return static_cast<int>(Object::cast_to<SpinBox>(edit)->get_value());
-	} else if (auto sch = dynamic_cast<const FloatSchema*>(schema)) {
-		return Object::cast_to<SpinBox>(edit)->get_value();
-	} else if (auto sch = dynamic_cast<const BoolSchema*>(schema)) {
-		return Object::cast_to<OptionButton>(edit)->is_pressed();
+	mark_dirty();
+	// Editors get reused for different elements (see ArrayEditor), so a value of the wrong type resets the editor as if it was just created instead of keeping the previous value
+	switch (node->kind) {
+		case SchemaKind::STRING: {
+			String text = value.get_type() == Variant::STRING ? static_cast<String>(value) : String{};
+			Object::cast_to<LineEdit>(edit)->set_text(text);
+			_update_pattern_hint(text);
+		} break;
+		case SchemaKind::ENUM: {
+			auto option = Object::cast_to<OptionButton>(edit);
+			if (value.get_type() == Variant::INT) {
+				option->select(option->get_item_index(value));
+			} else if (option->get_item_count() > 0) {
+				option->select(0);
+			}
+		} break;
+		case SchemaKind::INT: {
+			Object::cast_to<SpinBox>(edit)->set_value(value.get_type() == Variant::INT ? static_cast<int>(value) : 0);
+		} break;
+		case SchemaKind::FLOAT: {
+			Object::cast_to<SpinBox>(edit)->set_value(is_number(value) ? static_cast<double>(value) : 0.0);
+		} break;
+		case SchemaKind::BOOL: {
+			Object::cast_to<CheckBox>(edit)->set_pressed(value.get_type() == Variant::BOOL ? static_cast<bool>(value) : false);
+		} break;
+		default: break;
+	}
+	// After setting the value, which reports it as an edit that clears this
+	_set_mixed(root->is_mixed(this));
+}
+
+Variant ValueEditor::serialize() const {
+	switch (node->kind) {
+		case SchemaKind::STRING: return Object::cast_to<LineEdit>(edit)->get_text();
+		case SchemaKind::ENUM: return Object::cast_to<OptionButton>(edit)->get_selected_id();
+		case SchemaKind::INT: return static_cast<int>(Object::cast_to<SpinBox>(edit)->get_value());
+		case SchemaKind::FLOAT: return Object::cast_to<SpinBox>(edit)->get_value();
+		case SchemaKind::BOOL: return Object::cast_to<CheckBox>(edit)->is_pressed();
+		default: return Variant{};
+	}
+}
+
+ValueEditor::ValueEditor() {
+}
+
+ValueEditor::~ValueEditor() {
+}
+
+void RefEditor::_notification(int what) {
+	ListContainer::_notification(what);
+}
+
+Size2 RefEditor::_get_minimum_size() {
+	return ListContainer::_get_minimum_size();
+}
+
+void RefEditor::_post_init() {
+	clear->set_button_icon(get_icon("Remove", "EditorIcons"));
+}
+
+void RefEditor::_toggle_expanded() {
+	if (target) {
+		target_container->set_visible(!target_container->is_visible());
+		_update_toolbar();
+		return;
+	}
+
+	bool creating = value.get_type() == Variant::NIL;
+	auto target_node = schema->resolve(*node);
+	auto [container, editor] = root->acquire_editor(this, target_node, Variant{}, true);
+	editor->set_expanded(true);
+	target_container = container;
+	target = editor;
+	add_child(container);
+	mark_dirty();
+	_update_toolbar();
+
+	// A pooled editor already has its fields built, don't let their signals record edits while we fill them in
+	bool was_updating = root->is_updating();
+	root->set_updating(true);
+	if (creating) {
+		// The editor may come from the pool, with another value in it
+		target->read(make_default_value(schema, target_node));
 	} else {
-		return Variant{};
+		target->read(value);
+	}
+	root->set_updating(was_updating);
+
+	if (creating) {
+		root->record_edit({ EditDelta::SET, get_path(), save() });
 	}
 }
 
-ValueEditor::ValueEditor() {
+void RefEditor::_clear() {
+	_free_target();
+	value = Variant{};
+	mark_dirty();
+	_update_toolbar();
+	root->record_edit({ EditDelta::SET, get_path(), Variant{} });
 }
 
-ValueEditor::~ValueEditor() {
+void RefEditor::_free_target() {
+	if (target_container) {
+		root->release_editor(target_container, target, schema->resolve(*node));
+		target_container = nullptr;
+		target = nullptr;
+	}
+}
+
+void RefEditor::_update_toolbar() {
+	bool empty = !target && value.get_type() == Variant::NIL;
+	if (empty) {
+		expand->set_text("Create");
+	} else {
+		expand->set_text(target && target_container->is_visible() ? "Collapse" : "Expand");
+	}
+	clear->set_visible(!empty);
+}
+
+void RefEditor::_register_methods() {
+	register_method("_notification", &RefEditor::_notification);
+	register_method("_get_minimum_size", &RefEditor::_get_minimum_size);
+	register_method("_post_init", &RefEditor::_post_init);
+	register_method("_toggle_expanded", &RefEditor::_toggle_expanded);
+	register_method("_clear", &RefEditor::_clear);
+}
+
+void RefEditor::_init() {
+	set_direction(VERTICAL);
+
+	toolbar = HBoxContainer::_new();
+	add_child(toolbar);
+
+	title = Label::_new();
+	toolbar->add_child(title);
+	expand = Button::_new();
+	expand->set_flat(true);
+	expand->connect("pressed", this, "_toggle_expanded");
+	toolbar->add_child(expand);
+	clear = Button::_new();
+	clear->set_flat(true);
+	clear->set_tooltip("Set to null");
+	clear->connect("pressed", this, "_clear");
+	toolbar->add_child(clear);
+
+	call_deferred("_post_init");
+}
+
+void RefEditor::_custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key) {
+	this->root = root;
+	this->parent = parent;
+	this->schema = schema;
+	this->node = node;
+	this->key = key;
+
+	format_key_to(key, title);
+	_update_toolbar();
+}
+
+void RefEditor::set_key(const Variant& key) {
+	this->key = key;
+	format_key_to(key, title);
+}
+
+void RefEditor::read(const Variant& value) {
+	mark_dirty();
+	this->value = value;
+	if (target) {
+		if (value.get_type() == Variant::NIL) {
+			_free_target();
+		} else {
+			target->read(value);
+		}
+	}
+	_update_toolbar();
+}
+
+Variant RefEditor::serialize() const {
+	return target ? target->save() : value;
+}
+
+ResourceEditor* RefEditor::get_child_editor(const Variant& key) {
+	// The target edits the same value as this editor, so it has no key of its own
+	return target ? target->get_child_editor(key) : nullptr;
+}
+
+RefEditor::RefEditor() {
+}
+
+RefEditor::~RefEditor() {
+}
+
+const char* godot::structural_inspector::EDITOR_RELEASE_DELAY_SETTING = "structural_inspector/editor_release_delay";
+
+float godot::structural_inspector::get_editor_release_delay() {
+	auto settings = ProjectSettings::get_singleton();
+	if (settings->has_setting(EDITOR_RELEASE_DELAY_SETTING)) {
+		return settings->get_setting(EDITOR_RELEASE_DELAY_SETTING);
+	}
+	return DEFAULT_EDITOR_RELEASE_DELAY;
+}
+
+const char* godot::structural_inspector::EDIT_COALESCE_WINDOW_SETTING = "structural_inspector/edit_coalesce_window";
+
+float godot::structural_inspector::get_edit_coalesce_window() {
+	auto settings = ProjectSettings::get_singleton();
+	if (settings->has_setting(EDIT_COALESCE_WINDOW_SETTING)) {
+		return settings->get_setting(EDIT_COALESCE_WINDOW_SETTING);
+	}
+	return DEFAULT_EDIT_COALESCE_WINDOW;
+}
+
+const char* godot::structural_inspector::BUILD_BUDGET_SETTING = "structural_inspector/build_budget_msec";
+
+float godot::structural_inspector::get_build_budget() {
+	auto settings = ProjectSettings::get_singleton();
+	if (settings->has_setting(BUILD_BUDGET_SETTING)) {
+		return settings->get_setting(BUILD_BUDGET_SETTING);
+	}
+	return DEFAULT_BUILD_BUDGET;
+}
+
+void ResourceInspectorProperty::_notification(int what) {
+	switch (what) {
+		case NOTIFICATION_EXIT_TREE: {
+			// The inspector is about to free this property, e.g. because another object got selected
+			flush_changes();
+		} break;
+		case NOTIFICATION_PROCESS: {
+			_run_build_slice();
+		} break;
+		case NOTIFICATION_PREDELETE: {
+			build_queue.clear();
+			// A collapsed editor is not our child, so it wouldn't be freed with us
+			if (editor && !editor->get_parent()) {
+				editor->free();
+				editor = nullptr;
+			}
+			clear_editor_pool();
+		} break;
+	}
+}
+
+void ResourceInspectorProperty::_input(Ref<InputEvent> event) {
+	if (!editor || !editor->is_inside_tree()) {
+		return;
+	}
+
+	if (auto mm = Object::cast_to<InputEventMouseMotion>(event.ptr())) {
+		hover.mouse_moved(editor, get_global_mouse_position());
+		return;
+	}
+	if (auto mb = Object::cast_to<InputEventMouseButton>(event.ptr())) {
+		if (mb->get_button_index() == GlobalConstants::BUTTON_LEFT && mb->is_pressed()) {
+			// Every array the click is in selects its element, from the outermost one in
+			for (auto target : hover.find_targets_at(editor, get_global_mouse_position())) {
+				auto clicked = find_editor_from(target);
+				if (auto parent = clicked ? clicked->get_parent_editor() : nullptr) {
+					parent->_child_clicked(clicked, mb->get_shift(), mb->get_command());
+				}
+			}
+		}
+		return;
+	}
+}
+
+void ResourceInspectorProperty::_hovered_exiting() {
+	hover.forget_hovered();
 }
 
 void ResourceInspectorProperty::_toggle_editor_visibility() {
-	if (editor->is_visible()) {
+	if (editor && editor->is_visible()) {
+		flush_changes();
 		remove_child(editor);
 		set_bottom_editor(nullptr);
 		editor->set_visible(false);
-		btn->set_text("Expand");
+
+		float delay = get_editor_release_delay();
+		if (delay > 0) {
+			release_timer->start(delay);
+		} else {
+			_release_editor();
+		}
 	} else {
+		release_timer->stop();
+		if (!editor) {
+			editor = create_editor_shell(this, nullptr, schema.get(), schema_root, Variant{}).second;
+			editor->set_expanded(true);
+			updating = true;
+			editor->read(_get_shown_object()->get(get_edited_property()));
+			updating = false;
+		}
 		add_child(editor);
 		set_bottom_editor(editor);
 		editor->set_visible(true);
-		btn->set_text("Collapse");
+	}
+	_update_btn_text();
+}
+
+void ResourceInspectorProperty::_release_editor() {
+	if (editor && !editor->is_visible()) {
+		cancel_build(editor);
+		editor->free();
+		editor = nullptr;
+		// Releasing is meant to give the memory back, the pooled editors included
+		clear_editor_pool();
 	}
 }
 
 void ResourceInspectorProperty::_update_btn_text() {
-	// TODO
+	String text = editor && editor->is_visible() ? "Collapse" : "Expand";
+	if (errors.empty()) {
+		btn->set_text(text);
+		btn->set_tooltip("");
+		btn->set_button_icon(Ref<Texture>{});
+		return;
+	}
+
+	btn->set_text(text + " (" + String::num_int64(errors.size()) + " errors)");
+	btn->set_button_icon(get_icon("StatusWarning", "EditorIcons"));
+
+	// Keep the tooltip readable for values with lots of errors
+	static const size_t max_listed = 20;
+	String tooltip;
+	for (size_t i = 0; i < errors.size() && i < max_listed; ++i) {
+		tooltip += errors[i].path + ": " + errors[i].message + "\n";
+	}
+	if (errors.size() > max_listed) {
+		tooltip += "... and " + String::num_int64(errors.size() - max_listed) + " more";
+	}
+	btn->set_tooltip(tooltip);
+}
+
+void ResourceInspectorProperty::_validate(const Variant& value) {
+	errors.clear();
+	validator.validate(*schema, *schema_root, value, get_edited_property(), errors);
+	_update_btn_text();
 }
 
 void ResourceInspectorProperty::_register_methods() {
+	register_method("_notification", &ResourceInspectorProperty::_notification);
+	register_method("_input", &ResourceInspectorProperty::_input);
+	register_method("_hovered_exiting", &ResourceInspectorProperty::_hovered_exiting);
 	register_method("_toggle_editor_visibility", &ResourceInspectorProperty::_toggle_editor_visibility);
+	register_method("_release_editor", &ResourceInspectorProperty::_release_editor);
+	register_method("_deltas_applied", &ResourceInspectorProperty::_deltas_applied);
+	register_method("_refresh_queued_paths", &ResourceInspectorProperty::_refresh_queued_paths);
 	register_method("emit_something_changed", &ResourceInspectorProperty::emit_something_changed);
+	register_method("flush_changes", &ResourceInspectorProperty::flush_changes);
+	register_method("get_editor_pool_stats", &ResourceInspectorProperty::get_editor_pool_stats);
+	register_method("get_build_progress", &ResourceInspectorProperty::get_build_progress);
 	register_method("update_property", &ResourceInspectorProperty::update_property);
+
+	register_signal<ResourceInspectorProperty>("build_finished", Dictionary{});
 }
 
 void ResourceInspectorProperty::_init() {
 	btn = Button::_new();
 	btn->connect("pressed", this, "_toggle_editor_visibility");
 	add_child(btn);
+
+	hover.is_target = [](Control* control) { return Object::cast_to<BorderedContainer>(control) != nullptr; };
+	hover.set_hovered = [](Control* control, bool hovered) { static_cast<BorderedContainer*>(control)->set_hovered(hovered); };
+
+	release_timer = Timer::_new();
+	release_timer->set_one_shot(true);
+	release_timer->connect("timeout", this, "_release_editor");
+	add_child(release_timer);
+
+	flush_timer = Timer::_new();
+	flush_timer->set_one_shot(true);
+	flush_timer->connect("timeout", this, "flush_changes");
+	add_child(flush_timer);
+}
+
+void ResourceInspectorProperty::_custom_init(std::shared_ptr<const CompiledSchema> schema, const SchemaNode* node, Ref<EditHistory> history) {
+	this->schema = std::move(schema);
+	this->history = history;
+	if (history.is_valid()) {
+		history->connect("deltas_applied", this, "_deltas_applied");
+	}
+
+	schema_root = node;
+	_update_btn_text();
+}
+
+bool ResourceInspectorProperty::is_updating() const {
+	return updating;
+}
+
+void ResourceInspectorProperty::set_updating(bool updating) {
+	this->updating = updating;
 }
 
-void ResourceInspectorProperty::_custom_init(std::unique_ptr<Schema> schema_in) {
-	this->schema = std::move(schema_in);
-	auto schema = this->schema.get();
+void ResourceInspectorProperty::_queue_flush() {
+	if (changes_pending) return;
 
-	editor = create_edit_overloaded(this, nullptr, schema, Variant{}).second;
-	editor->set_visible(false);
+	changes_pending = true;
+	float window = get_edit_coalesce_window();
+	if (window > 0) {
+		flush_timer->start(window);
+	} else {
+		call_deferred("flush_changes");
+	}
 }
 
 void ResourceInspectorProperty::emit_something_changed() {
-	if (updating) return;
+	if (updating || !editor) return;
 
-	emit_changed(get_edited_property(), editor->save(), "", true);
+	full_value_pending = true;
+	_queue_flush();
 }
 
-void ResourceInspectorProperty::update_property() {
+void ResourceInspectorProperty::record_edit(EditDelta delta) {
+	if (updating || !editor) return;
+
+	// e.g. typing into the same field
+	if (!pending_edits.empty() && pending_edits.back().size() == 1 && delta.kind == EditDelta::SET) {
+		auto& last = pending_edits.back().front();
+		if (last.kind == EditDelta::SET && variant_equals(last.path, delta.path)) {
+			last.value = delta.value;
+			_queue_flush();
+			return;
+		}
+	}
+	pending_edits.emplace_back();
+	pending_edits.back().push_back(std::move(delta));
+	_queue_flush();
+}
+
+void ResourceInspectorProperty::record_edits(std::vector<EditDelta> deltas) {
+	if (updating || !editor || deltas.empty()) return;
+
+	pending_edits.push_back(std::move(deltas));
+	_queue_flush();
+}
+
+void ResourceInspectorProperty::flush_changes() {
+	if (!changes_pending) return;
+
+	changes_pending = false;
+	flush_timer->stop();
+	auto value = editor->save();
+	_validate(value);
+
+	auto shown = _get_shown_object();
+	auto property = get_edited_property();
+	auto objects = targets.empty() ? std::vector<Object*>{ shown } : targets;
+	bool committed = history.is_valid() && !full_value_pending;
+	bool all_committed = committed;
+	if (committed) {
+		committing = true;
+		for (auto& deltas : pending_edits) {
+			if (!history->commit(objects, property, deltas)) {
+				all_committed = false;
+				break;
+			}
+		}
+		committing = false;
+	}
+	pending_edits.clear();
+	full_value_pending = false;
+
+	echo_pending = true;
+	if (all_committed) {
+		// Still the same dictionary or array, modified in place
+		synced_value = shown->get(property);
+	} else if (targets.empty()) {
+		// Emitting the whole value also covers the deltas that were committed
+		synced_value = value;
+		emit_changed(property, value, "", true);
+	} else if (committed) {
+		// Writing the whole value would overwrite what differs between the targets, drop the edit instead
+		ERR_PRINT("The edit doesn't apply to all selected objects of " + property + ", e.g. an array is shorter in some of them, or one of them doesn't keep the value it is set to");
+		// Nothing was written
+		echo_pending = false;
+		synced_value = shown->get(property);
+		updating = true;
+		editor->read(synced_value);
+		_validate(synced_value);
+		updating = false;
+	} else if (history.is_valid()) {
+		// The history gives each target its own copy, a MultiNodeEdit would make them share it
+		history->commit(targets, property, { EditDelta{ EditDelta::SET, Array{}, value } });
+		synced_value = shown->get(property);
+	} else {
+		synced_value = value;
+		emit_changed(property, value, "", true);
+	}
+	_update_mixed_paths();
+}
+
+/// `value[key]`, or nil if there is no such element
+static Variant get_child_value(const Variant& value, const Variant& key) {
+	switch (value.get_type()) {
+		case Variant::DICTIONARY: {
+			const Dictionary dict = value;
+			return dict.has(key) ? dict[key] : Variant{};
+		}
+		case Variant::ARRAY: {
+			const Array array = value;
+			if (key.get_type() != Variant::INT || static_cast<int>(key) < 0 || static_cast<int>(key) >= array.size()) {
+				return Variant{};
+			}
+			return array[key];
+		}
+		default: return Variant{};
+	}
+}
+
+/// Whether `a` and `b` are elements of the same array or dictionary
+static bool has_same_parent(const Array& a, const Array& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (int i = 0; i < a.size() - 1; ++i) {
+		if (!variant_equals(a[i], b[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ResourceInspectorProperty::_deltas_applied(Object* object, String property, Array paths, Array kinds) {
+	if (committing || property != get_edited_property()) return;
+	if (targets.empty() ? object != get_edited_object() : std::find(targets.begin(), targets.end(), object) == targets.end()) return;
+
+	// Undoing goes back to before the edits that weren't flushed yet as well
+	pending_edits.clear();
+	full_value_pending = false;
+	changes_pending = false;
+	flush_timer->stop();
+
+	if (targets.empty()) {
+		_refresh_paths(paths, kinds);
+		return;
+	}
+
+	// Undo/redo applies the deltas one target after the other, which values differ is only known after the last one
+	if (object == _get_shown_object()) {
+		for (int i = 0; i < paths.size(); ++i) {
+			queued_paths.append(paths[i]);
+			queued_kinds.append(kinds[i]);
+		}
+	}
+	if (!refresh_queued) {
+		refresh_queued = true;
+		call_deferred("_refresh_queued_paths");
+	}
+}
+
+void ResourceInspectorProperty::_refresh_queued_paths() {
+	refresh_queued = false;
+	Array paths = queued_paths;
+	Array kinds = queued_kinds;
+	queued_paths = Array{};
+	queued_kinds = Array{};
+	_update_mixed_paths();
+	_refresh_paths(paths, kinds);
+}
+
+void ResourceInspectorProperty::_refresh_paths(const Array& paths, const Array& kinds) {
+	auto value = _get_shown_object()->get(get_edited_property());
+	synced_value = value;
+	echo_pending = true;
+	_revalidate_paths(value, paths, kinds);
+	if (!editor) return;
+
+	// Only the changed parts are read again, each starting from the deepest editor showing it.
+	// A set is read into the editor of the value itself, inserting, removing or moving an element into the array's editor.
+	updating = true;
+	for (int i = 0; i < paths.size(); ++i) {
+		const Array path = paths[i];
+		int kind = kinds[i];
+		// Reading the array after the first of several inserts or removals in it already shows all of them
+		if (i > 0 && kind != EditDelta::SET && kind != EditDelta::ERASE && static_cast<int>(kinds[i - 1]) == kind && has_same_parent(paths[i - 1], path)) {
+			continue;
+		}
+		int depth = kind == EditDelta::SET || kind == EditDelta::ERASE ? path.size() : path.size() - 1;
+		ResourceEditor* target = editor;
+		Variant target_value = value;
+		for (int j = 0; j < depth && target; ++j) {
+			auto child_value = get_child_value(target_value, path[j]);
+			if (auto child = target->get_child_editor(path[j])) {
+				target = child;
+				target_value = child_value;
+			} else {
+				target->read_child(path[j], child_value, target_value);
+				target = nullptr;
+			}
+		}
+		if (target) {
+			target->read(target_value);
+		}
+	}
+	updating = false;
+}
+
+/// Walks the first `depth` elements of `path` down from `node` and `value`, and appends them to `error_path` in the format of validation errors.
+/// Stops early where the value doesn't match the schema or the element is missing, errors about those are reported by the parent.
+static void find_validated_subtree(const CompiledSchema& schema, const Array& path, int depth, const SchemaNode*& node, Variant& value, String& error_path) {
+	for (int i = 0; i < depth; ++i) {
+		auto current = node;
+		while (current && current->kind == SchemaKind::REF) {
+			current = schema.resolve(*current);
+		}
+		if (!current) {
+			return;
+		}
+
+		const Variant& key = path[i];
+		const SchemaNode* child = nullptr;
+		if (current->kind == SchemaKind::STRUCT && value.get_type() == Variant::DICTIONARY && key.get_type() == Variant::STRING) {
+			const Dictionary dict = value;
+			String name = key;
+			for (uint32_t j = 0; j < current->count; ++j) {
+				if (schema.get_field(*current, j).name == name) {
+					// A missing field is reported on the field's path, but an unknown one on the dictionary's
+					child = dict.has(key) ? &schema.get_field_node(*current, j) : nullptr;
+					break;
+				}
+			}
+		} else if (current->kind == SchemaKind::ARRAY && value.get_type() == Variant::ARRAY) {
+			const Array array = value;
+			if (key.get_type() == Variant::INT && static_cast<int>(key) >= 0 && static_cast<int>(key) < array.size()) {
+				child = &schema.get_element_type(*current);
+			}
+		}
+		if (!child) {
+			return;
+		}
+
+		node = child;
+		value = get_child_value(value, key);
+		error_path += key.get_type() == Variant::INT ? "[" + String::num_int64(key) + "]" : "." + static_cast<String>(key);
+	}
+}
+
+/// Whether `path` or one of the paths containing it is in `roots`, e.g. `contents[3].name` is inside `contents` and `contents[3]`
+static bool is_inside_any(const String& path, const std::unordered_set<String>& roots, bool include_self) {
+	if (include_self && roots.count(path)) {
+		return true;
+	}
+	for (int i = 1; i < path.length(); ++i) {
+		if ((path[i] == '.' || path[i] == '[') && roots.count(path.substr(0, i))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResourceInspectorProperty::_revalidate_paths(const Variant& value, const Array& paths, const Array& kinds) {
+	struct Subtree {
+		const SchemaNode* node;
+		Variant value;
+		String error_path;
+	};
+
+	// The errors of a struct or array depend on its elements, so removing, inserting or erasing one validates the parent again
+	std::vector<Subtree> subtrees;
+	std::unordered_set<String> error_paths;
+	for (int i = 0; i < paths.size(); ++i) {
+		const Array path = paths[i];
+		int kind = kinds[i];
+		if (path.empty()) {
+			_validate(value);
+			return;
+		}
+		Subtree subtree{ schema_root, value, get_edited_property() };
+		find_validated_subtree(*schema, path, kind == EditDelta::SET ? path.size() : path.size() - 1, subtree.node, subtree.value, subtree.error_path);
+		if (error_paths.insert(subtree.error_path).second) {
+			subtrees.push_back(std::move(subtree));
+		}
+	}
+
+	// Replace the old errors where the first of them was, so that the list keeps the order of the value
+	std::vector<ValidationError> kept;
+	size_t replaced_at = SIZE_MAX;
+	for (auto& error : errors) {
+		if (is_inside_any(error.path, error_paths, true)) {
+			replaced_at = std::min(replaced_at, kept.size());
+		} else {
+			kept.push_back(std::move(error));
+		}
+	}
+	std::vector<ValidationError> found;
+	for (auto& subtree : subtrees) {
+		if (!is_inside_any(subtree.error_path, error_paths, false)) {
+			validator.validate(*schema, *subtree.node, subtree.value, subtree.error_path, found);
+		}
+	}
+	replaced_at = std::min(replaced_at, kept.size());
+	kept.insert(kept.begin() + replaced_at, std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+	errors = std::move(kept);
+	_update_btn_text();
+}
+
+Object* ResourceInspectorProperty::_get_shown_object() {
+	return targets.empty() ? get_edited_object() : targets.front();
+}
+
+/// e.g. `contents/3/name`, only used as a key of ResourceInspectorProperty::mixed_paths
+static String format_path_key(const Array& path) {
+	String result;
+	for (int i = 0; i < path.size(); ++i) {
+		result += "/";
+		result += path[i].get_type() == Variant::INT ? String::num_int64(path[i]) : static_cast<String>(path[i]);
+	}
+	return result;
+}
+
+/// Adds the path of every place where `values` differ to `mixed`, `path` is where `values` are and is restored before returning
+static void collect_mixed_paths(const std::vector<Variant>& values, Array& path, std::unordered_set<String>& mixed) {
+	auto& first = values.front();
+	bool same = std::all_of(values.begin() + 1, values.end(), [&first](const Variant& value) { return variant_equals(first, value); });
+	if (same) {
+		return;
+	}
+	mixed.insert(format_path_key(path));
+
+	// Only values of the same type have elements in common
+	auto type = first.get_type();
+	if (!std::all_of(values.begin(), values.end(), [type](const Variant& value) { return value.get_type() == type; })) {
+		return;
+	}
+	std::vector<Variant> children(values.size());
+	switch (type) {
+		case Variant::DICTIONARY: {
+			const Dictionary first_dict = first;
+			Array keys = first_dict.keys();
+			for (int k = 0; k < keys.size(); ++k) {
+				for (size_t i = 0; i < values.size(); ++i) {
+					const Dictionary dict = values[i];
+					children[i] = dict.has(keys[k]) ? dict[keys[k]] : Variant{};
+				}
+				path.append(keys[k]);
+				collect_mixed_paths(children, path, mixed);
+				path.remove(path.size() - 1);
+			}
+		} break;
+		case Variant::ARRAY: {
+			// Elements past the end of the shortest array only exist in some of the values, the array itself is already mixed
+			int count = INT_MAX;
+			for (auto& value : values) {
+				count = std::min(count, static_cast<Array>(value).size());
+			}
+			for (int idx = 0; idx < count; ++idx) {
+				for (size_t i = 0; i < values.size(); ++i) {
+					const Array array = values[i];
+					children[i] = array[idx];
+				}
+				path.append(idx);
+				collect_mixed_paths(children, path, mixed);
+				path.remove(path.size() - 1);
+			}
+		} break;
+		default: break;
+	}
+}
+
+void ResourceInspectorProperty::_update_mixed_paths() {
+	mixed_paths.clear();
+	if (targets.size() < 2) {
+		return;
+	}
+
+	std::vector<Variant> values;
+	values.reserve(targets.size());
+	for (auto target : targets) {
+		values.push_back(target->get(get_edited_property()));
+	}
+	Array path;
+	collect_mixed_paths(values, path, mixed_paths);
+}
+
+void ResourceInspectorProperty::set_edit_targets(std::vector<Object*> targets) {
+	this->targets = std::move(targets);
+	echo_pending = false;
+}
+
+bool ResourceInspectorProperty::has_edit_targets() const {
+	return !targets.empty();
+}
+
+bool ResourceInspectorProperty::is_mixed(const ResourceEditor* editor) const {
+	if (mixed_paths.empty()) {
+		return false;
+	}
+	return mixed_paths.count(format_path_key(editor->get_path())) > 0;
+}
+
+static constexpr size_t MAX_POOLED_EDITORS = 256;
+static constexpr size_t MAX_POOLED_EDITORS_PER_NODE = 64;
+
+std::pair<Control*, ResourceEditor*> ResourceInspectorProperty::acquire_editor(ResourceEditor* parent, const SchemaNode* node, const Variant& key, bool add_border) {
+	auto it = editor_pool.find(node);
+	if (it != editor_pool.end()) {
+		auto& pooled = it->second;
+		// Bordered and plain editors have a different container, search from the back to reuse the most recently released one
+		for (auto i = pooled.size(); i-- > 0;) {
+			if ((pooled[i].control != pooled[i].editor) == add_border) {
+				auto [control, editor] = pooled[i];
+				pooled.erase(pooled.begin() + i);
+				--pooled_count;
+				++pool_hits;
+
+				editor->set_parent_editor(parent);
+				editor->set_key(key);
+				return { control, editor };
+			}
+		}
+	}
+
+	++pool_misses;
+	return create_editor_shell(this, parent, schema.get(), node, key, add_border);
+}
+
+void ResourceInspectorProperty::release_editor(Control* control, ResourceEditor* editor, const SchemaNode* node) {
+	cancel_build(editor);
+	if (auto p = control->get_parent()) {
+		p->remove_child(control);
+	}
+
+	auto& pooled = editor_pool[node];
+	if (pooled_count >= MAX_POOLED_EDITORS || pooled.size() >= MAX_POOLED_EDITORS_PER_NODE) {
+		control->free();
+		++pool_evictions;
+		return;
+	}
+
+	// Collapsing also returns the rows of arrays to the pool
+	editor->set_expanded(false);
+	editor->set_parent_editor(nullptr);
+	control->set_visible(true);
+	pooled.push_back({ control, editor });
+	++pooled_count;
+}
+
+void ResourceInspectorProperty::clear_editor_pool() {
+	for (auto& [node, pooled] : editor_pool) {
+		for (auto& entry : pooled) {
+			entry.control->free();
+		}
+	}
+	editor_pool.clear();
+	pooled_count = 0;
+}
+
+Dictionary ResourceInspectorProperty::get_editor_pool_stats() {
+	Dictionary stats;
+	stats["pooled"] = static_cast<int64_t>(pooled_count);
+	stats["hits"] = pool_hits;
+	stats["misses"] = pool_misses;
+	stats["evictions"] = pool_evictions;
+	int64_t total = pool_hits + pool_misses;
+	stats["hit_rate"] = total > 0 ? static_cast<double>(pool_hits) / total : 0.0;
+	return stats;
+}
+
+void ResourceInspectorProperty::queue_build(ResourceEditor* editor) {
+	if (std::find(build_queue.begin(), build_queue.end(), editor) == build_queue.end()) {
+		build_queue.push_back(editor);
+	}
+	if (building) {
+		// Picked up by the running slice
+		return;
+	}
+	if (get_build_budget() <= 0) {
+		_run_build_slice();
+	} else {
+		set_process(true);
+	}
+}
+
+void ResourceInspectorProperty::cancel_build(ResourceEditor* editor) {
+	build_queue.erase(
+			std::remove_if(build_queue.begin(), build_queue.end(), [&](ResourceEditor* queued) { return queued == editor || editor->is_a_parent_of(queued); }),
+			build_queue.end());
+}
+
+void ResourceInspectorProperty::_run_build_slice() {
+	if (build_queue.empty()) {
+		set_process(false);
+		return;
+	}
+
+	auto deadline = make_build_deadline();
+	building = true;
+	// Building reads the current value into the new editors, that is not an edit
+	bool was_updating = updating;
 	updating = true;
+	while (!build_queue.empty()) {
+		auto editor = build_queue.back();
+		build_queue.pop_back();
+		if (editor->_build_children(build_queue, deadline)) {
+			++builds_finished;
+		} else {
+			// Resumed before the children it just created, those are collapsed and have nothing to build anyway
+			build_queue.push_back(editor);
+		}
+
+		if (OS::get_singleton()->get_ticks_usec() >= deadline) {
+			break;
+		}
+	}
+	updating = was_updating;
+	building = false;
+	++build_slices;
+
+	set_process(!build_queue.empty());
+	if (build_queue.empty()) {
+		emit_signal("build_finished");
+	}
+}
 
-	auto prop = get_edited_object()->get(get_edited_property());
-	editor->read(prop);
+Dictionary ResourceInspectorProperty::get_build_progress() {
+	Dictionary progress;
+	progress["queued"] = static_cast<int64_t>(build_queue.size());
+	progress["finished"] = builds_finished;
+	progress["slices"] = build_slices;
+	progress["budget_msec"] = get_build_budget();
+	return progress;
+}
+
+void ResourceInspectorProperty::update_property() {
+	// Otherwise the pending edits would be overwritten by the value from before them
+	flush_changes();
+
+	auto prop = _get_shown_object()->get(get_edited_property());
+	// Right after our own write this is the inspector handing back the value we just wrote, which the editor already shows.
+	// Dictionaries compare by reference and arrays element by element, so this is much cheaper than reading the value into the editor.
+	// With several targets the others may have changed, so they are always compared.
+	bool echo = echo_pending;
+	echo_pending = false;
+	if (echo && targets.empty() && prop.get_type() == synced_value.get_type() && prop == synced_value) {
+		return;
+	}
+	synced_value = prop;
+	_update_mixed_paths();
+
+	updating = true;
+	if (editor) {
+		editor->read(prop);
+	}
+	_validate(prop);
 
 	updating = false;
 }
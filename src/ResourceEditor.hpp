@@ -1,8 +1,12 @@
 #pragma once
 
+#include "CompiledSchema.hpp"
+#include "EditHistory.hpp"
 #include "Schema.hpp"
 #include "Utils.hpp"
+#include "Validation.hpp"
 
+#include <AcceptDialog.hpp>
 #include <Button.hpp>
 #include <Control.hpp>
 #include <EditorProperty.hpp>
@@ -11,12 +15,17 @@
 #include <Label.hpp>
 #include <LineEdit.hpp>
 #include <MarginContainer.hpp>
+#include <MenuButton.hpp>
 #include <OptionButton.hpp>
+#include <ScrollContainer.hpp>
 #include <SpinBox.hpp>
+#include <Timer.hpp>
 #include <VBoxContainer.hpp>
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace godot::structural_inspector {
 
@@ -25,14 +34,50 @@ class ResourceEditor : public ListContainer {
 protected:
 	ResourceInspectorProperty* root;
 	ResourceEditor* parent;
+	// Owned by `root`
+	const CompiledSchema* schema;
+	const SchemaNode* node;
+	// Field name or array index of this editor's value in its parent's value, nil for the root editor and RefEditor targets
+	Variant key;
+
+	/// Build the value from the current state of the editor, called by save() when the editor changed since last time
+	virtual Variant serialize() const;
+
+private:
+	// Result of the last save(), reused until this editor or one of its descendants changes
+	Variant saved_value;
+	bool dirty = true;
 
 public:
 	static void _register_methods();
 	void _init();
 
+	ResourceEditor* get_parent_editor() const;
+	/// Used when an editor is reused for another parent, see ResourceInspectorProperty::acquire_editor()
+	void set_parent_editor(ResourceEditor* parent);
+	/// Called by the property's HoverTracker when a bordered child editor was clicked, `range` and `toggle` are set for shift and ctrl (cmd on macOS) clicks
+	virtual void _child_clicked(ResourceEditor* child, bool range, bool toggle);
 	virtual void set_key(const Variant& key);
 	virtual void read(const Variant& value);
-	virtual Variant save() const;
+	/// Returns the cached value unless mark_dirty() was called since the last save(), so saving an edit only serializes the editors between it and the root
+	Variant save();
+	/// Called whenever the state of the editor changes, invalidates the saved value of this editor and all of its ancestors
+	void mark_dirty();
+	/// Keys from the property's value down to this editor's value, for EditDelta
+	Array get_path() const;
+
+	/// The editor showing the value at `key`, or nullptr if it doesn't have one (e.g. an array element out of view)
+	virtual ResourceEditor* get_child_editor(const Variant& key);
+	/// Called instead of reading into get_child_editor(key) when that doesn't exist, `value` is the new value of this editor as a whole
+	virtual void read_child(const Variant& key, const Variant& child_value, const Variant& value);
+
+	/// Struct and array editors only create editors for their children once expanded, other editors ignore this
+	virtual void set_expanded(bool expanded);
+
+	/// Create editors for the direct children of this editor's schema node, and append them to `pending` so that their own children get built too.
+	/// Called from the property's build job (see ResourceInspectorProperty::queue_build()) instead of recursively from _custom_init(), so that deep schemas don't overflow the stack.
+	/// Stops once OS::get_ticks_usec() reaches `deadline_usec`, but always makes some progress; returns false if there is more left, in which case it is called again on a later frame.
+	virtual bool _build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec);
 
 	ResourceEditor();
 	~ResourceEditor();
@@ -41,55 +86,188 @@ public:
 class StructEditor : public ResourceEditor {
 	GODOT_CLASS(StructEditor, ResourceEditor)
 private:
-	const StructSchema* schema;
 	HBoxContainer* toolbar;
+	Button* expand;
 	Label* title;
+	// One line version of the value, shown while collapsed
+	Label* summary;
 	VBoxContainer* fields;
+	// Shown below the fields while they are still being built
+	Label* progress;
+	bool expanded = false;
+	// Number of field editors created so far, they hold the value of their field instead of `value`
+	uint32_t built_count = 0;
+	// Whether all field editors were created
+	bool built = false;
+	Variant value;
 
 	void _notification(int what);
 	Size2 _get_minimum_size();
+	void _post_init();
+	void _toggle_expanded();
+	void _update_toolbar();
+	void _update_progress();
 
 public:
 	static void _register_methods();
 	void _init();
-	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const StructSchema* schema, const Variant& key);
+	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key);
 
 	void set_key(const Variant& key) override;
 	void read(const Variant& value) override;
-	Variant save() const override;
+	Variant serialize() const override;
+	void set_expanded(bool expanded) override;
+	bool _build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec) override;
+	ResourceEditor* get_child_editor(const Variant& key) override;
 
 	StructEditor();
 	~StructEditor();
 };
 
+/// Only the elements inside the visible part of the inspector get an editor (a "row"), rows that scroll out of view are reused for other elements.
+/// Elements that were never shown are sized with the average height of the ones that were.
 class ArrayEditor : public ResourceEditor {
 	GODOT_CLASS(ArrayEditor, ResourceEditor)
 private:
-	const ArraySchema* schema;
+	struct Row {
+		Control* control;
+		ResourceEditor* editor;
+		// Element shown by this row, -1 if the row is free to be reused
+		int index;
+	};
+
 	HBoxContainer* toolbar;
+	Button* expand;
 	Label* title;
+	Label* summary;
 	Button* add;
 	Button* remove;
-	VBoxContainer* elements;
+	// Rows are positioned manually, the minimum height of `elements` is the height of all elements whether they have a row or not
+	Control* elements;
+	// Closest ScrollContainer ancestor, used to find the visible part of `elements`
+	ScrollContainer* scroll = nullptr;
+	// Element clicked last, which shift-click selects a range from
 	int64_t selected_idx = -1;
+	// Selected elements in ascending order
+	std::vector<int> selection;
+	bool expanded = false;
+
+	enum BulkOperation {
+		BULK_SET,
+		BULK_OFFSET,
+		BULK_CLEAR,
+	};
+	// Edits one field of all selected elements at once, only shown when the elements are structs with scalar fields
+	HBoxContainer* bulk_bar;
+	Label* bulk_label;
+	OptionButton* bulk_field;
+	LineEdit* bulk_value;
+	Button* bulk_offset;
+	// Resolved struct node of the elements, nullptr if they aren't structs with scalar fields
+	const SchemaNode* element_struct = nullptr;
+
+	enum ArrayOperation {
+		OPERATION_SORT_ASCENDING,
+		OPERATION_SORT_DESCENDING,
+		OPERATION_DEDUPE,
+		OPERATION_MOVE_UP,
+		OPERATION_MOVE_DOWN,
+		OPERATION_MOVE_TOP,
+		OPERATION_MOVE_BOTTOM,
+		OPERATION_MOVE_TO,
+		OPERATION_COUNT,
+	};
+	// Sorting, deduplicating and moving elements. Item ids are `key index * OPERATION_COUNT + operation`.
+	MenuButton* operations;
+	// What the sort and dedupe items compare: a field name, or nil for the elements themselves
+	std::vector<Variant> operation_keys;
+	AcceptDialog* move_dialog;
+	SpinBox* move_index;
+
+	// Value of each element, except for elements that currently have a row, in which case the row's editor is the source of truth
+	Array values;
+	// Whether `values` is also referenced outside of this editor (the edited array after read(), or the array returned by serialize()),
+	// in which case it is copied before the first element is written back. Mutable since serialize() hands out `values` itself.
+	mutable bool values_shared = false;
+	std::vector<Row> rows;
+	// Measured height of each element, or a negative number if it never had a row
+	std::vector<float> row_heights;
+	// Position of each element within `elements`, with an extra entry at the end for the total height
+	std::vector<float> row_offsets;
+	float measured_height_sum = 0;
+	int measured_count = 0;
+	bool offsets_dirty = true;
+	bool update_queued = false;
 
-	ResourceEditor* _get_editor_at(int idx);
+	/// Copies `values` if it is shared, before it is modified in place
+	void _own_values();
+	/// Writes an element back to `values`, which is only copied if it is shared and the element actually changed
+	void _store_element(int idx, const Variant& element);
+	float _get_row_height(int idx) const;
+	void _rebuild_offsets();
+	int _acquire_row();
+	void _release_row(Row& row, bool sync);
+	void _release_rows(bool sync);
+	/// Give rows back to the inspector's editor pool, all of them or only the free rows past a few spares
+	void _return_rows(bool all);
+	void _queue_update_rows();
+	void _update_rows();
+	/// Binds rows to the visible elements until `deadline_usec`, returns false if some are still missing a row
+	bool _layout_rows(int64_t deadline_usec);
+	void _update_toolbar();
+	bool _is_selected(int idx) const;
+	void _update_row_selection();
+	void _setup_bulk_fields();
+	void _setup_operations();
+	/// Rearranges the elements so that the element at `order[i]` ends up at `i`, elements missing from `order` are removed.
+	/// Rows follow their element, so only the rows on screen get a new key, and the layout is updated once afterwards.
+	void _reorder(const std::vector<int>& order);
+	/// Records the change made by _reorder(), as a move if a single element moved and as a set of the whole array otherwise
+	void _record_reorder(int moved_from, int moved_to);
 
 	void _post_init();
-	void _element_gui_input(Ref<InputEvent> event, Control* element);
+	void _toggle_expanded();
 	void _add_element();
 	void _remove_element();
+	void _operations_about_to_show();
+	void _operation_pressed(int id);
+	void _move_dialog_confirmed();
+	void _bulk_field_selected(int idx);
+	void _bulk_set();
+	void _bulk_offset();
+	void _bulk_clear();
+	/// Changes the chosen field of every selected element in one pass, recorded as a single undoable edit
+	void _bulk_apply(BulkOperation operation);
 	void _notification(int what);
 	Size2 _get_minimum_size();
 
 public:
 	static void _register_methods();
 	void _init();
-	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const ArraySchema* schema, const Variant& key);
+	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key);
 
 	void set_key(const Variant& key) override;
 	void read(const Variant& value) override;
-	Variant save() const override;
+	Variant serialize() const override;
+	void set_expanded(bool expanded) override;
+	void _child_clicked(ResourceEditor* child, bool range, bool toggle) override;
+	bool _build_children(std::vector<ResourceEditor*>& pending, int64_t deadline_usec) override;
+	ResourceEditor* get_child_editor(const Variant& key) override;
+	void read_child(const Variant& key, const Variant& child_value, const Variant& value) override;
+
+	struct SortKey {
+		// Field name, or nil to compare the elements themselves
+		Variant field;
+		bool descending;
+	};
+	/// Stable sort by `keys`, the first one deciding first
+	void sort_elements(const std::vector<SortKey>& keys);
+	/// Keeps only the first element of each distinct value of `field` (nil compares the elements themselves)
+	void dedupe_elements(const Variant& field);
+	/// Moves the selected elements one position up (`offset` -1) or down (1), an element stops when it reaches the edge or another selected element
+	void move_selection(int offset);
+	/// Moves the selected elements next to each other, in their current order, so that the first one ends up at `index`
+	void move_selection_to(int index);
 
 	ArrayEditor();
 	~ArrayEditor();
@@ -98,52 +276,207 @@ public:
 class ValueEditor : public ResourceEditor {
 	GODOT_CLASS(ValueEditor, ResourceEditor)
 private:
-	const Schema* schema;
-	Label* title;
+	Label* title = nullptr;
 	Control* edit;
+	bool mixed = false;
 
 	void _notification(int what);
+	void _set_mixed(bool mixed);
 	Size2 _get_minimum_size();
 	void _update_string_value(const String& value);
 	void _update_enum_value(int idx);
 	void _update_int_value(int value);
 	void _update_float_value(float value);
 	void _update_bool_value(bool value);
+	void _text_entered(const String& text);
+	void _focus_exited();
+	void _update_pattern_hint(const String& value);
 
 public:
 	static void _register_methods();
 	void _init();
-	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const Schema* schema, const Variant& key);
+	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key);
 
 	void set_key(const Variant& key) override;
 	void read(const Variant& value) override;
-	Variant save() const override;
+	Variant serialize() const override;
 
 	ValueEditor();
 	~ValueEditor();
 };
 
+/// Editor for a reference to a recursive definition (e.g. a tree node that has an array of tree nodes).
+/// The definition's editor is only created when expanded, so that building the editor doesn't recurse forever; null values are allowed.
+class RefEditor : public ResourceEditor {
+	GODOT_CLASS(RefEditor, ResourceEditor)
+private:
+	HBoxContainer* toolbar;
+	Label* title;
+	Button* expand;
+	Button* clear;
+	// Created on first expansion, `target` is the child of `target_container`
+	Control* target_container = nullptr;
+	ResourceEditor* target = nullptr;
+	// Last value passed to read(), returned as-is by serialize() until expanded
+	Variant value;
+
+	void _notification(int what);
+	Size2 _get_minimum_size();
+	void _post_init();
+	void _toggle_expanded();
+	void _clear();
+	void _free_target();
+	void _update_toolbar();
+
+public:
+	static void _register_methods();
+	void _init();
+	void _custom_init(ResourceInspectorProperty* root, ResourceEditor* parent, const CompiledSchema* schema, const SchemaNode* node, const Variant& key);
+
+	void set_key(const Variant& key) override;
+	void read(const Variant& value) override;
+	Variant serialize() const override;
+	ResourceEditor* get_child_editor(const Variant& key) override;
+
+	RefEditor();
+	~RefEditor();
+};
+
+/// Project setting for how many seconds a collapsed property keeps its editor around before freeing it
+extern const char* EDITOR_RELEASE_DELAY_SETTING;
+static constexpr float DEFAULT_EDITOR_RELEASE_DELAY = 30.0F;
+float get_editor_release_delay();
+/// Project setting for how many seconds edits are collected before being emitted together, 0 to emit once per frame
+extern const char* EDIT_COALESCE_WINDOW_SETTING;
+static constexpr float DEFAULT_EDIT_COALESCE_WINDOW = 0.25F;
+float get_edit_coalesce_window();
+/// Project setting for how many milliseconds per frame may be spent building editors, 0 to build everything at once
+extern const char* BUILD_BUDGET_SETTING;
+static constexpr float DEFAULT_BUILD_BUDGET = 4.0F;
+float get_build_budget();
+
 class ResourceInspectorProperty : public EditorProperty {
 	GODOT_CLASS(ResourceInspectorProperty, EditorProperty)
 private:
-	std::unique_ptr<Schema> schema;
+	std::shared_ptr<const CompiledSchema> schema;
+	const SchemaNode* schema_root;
 	Button* btn;
-	ResourceEditor* editor;
+	// Created when first expanded, and freed after being collapsed for get_editor_release_delay() seconds
+	ResourceEditor* editor = nullptr;
+	Timer* release_timer;
 	bool updating = false;
+	// Set by emit_something_changed() and record_edit() until the edits are emitted by flush_changes()
+	bool changes_pending = false;
+	Timer* flush_timer;
+	// Last value written by flush_changes() or undo/redo, or read by update_property()
+	Variant synced_value;
+	// Set when we wrote `synced_value` to the property ourselves, the next update_property() is the inspector handing it back and doesn't need reading.
+	// Consumed by that call, so that a value changed in place by anything else (a tool script, `_set()`, another inspector) is always read again
+	bool echo_pending = false;
+
+	// Edits are committed to `history` as deltas, unless the edited value doesn't have the place they change yet (e.g. the property is still nil)
+	Ref<EditHistory> history;
+	// Each group is committed as one undoable action
+	std::vector<std::vector<EditDelta>> pending_edits;
+	// Set by emit_something_changed(), which doesn't say what changed
+	bool full_value_pending = false;
+	// Set while our own deltas are applied, which the editors already show
+	bool committing = false;
+
+	// Objects edited together (the nodes behind a MultiNodeEdit), empty when editing a single object. The editors show the first one.
+	std::vector<Object*> targets;
+	// Paths (see format_path_key()) where the values of the targets differ, including the dictionaries and arrays holding them
+	std::unordered_set<String> mixed_paths;
+	// Changes applied by undo/redo, shown once every target got its part
+	Array queued_paths;
+	Array queued_kinds;
+	bool refresh_queued = false;
+
+	struct PooledEditor {
+		Control* control;
+		ResourceEditor* editor;
+	};
+	// Detached editors kept for reuse, by the schema node they were created for
+	std::unordered_map<const SchemaNode*, std::vector<PooledEditor>> editor_pool;
+	size_t pooled_count = 0;
+	int64_t pool_hits = 0;
+	int64_t pool_misses = 0;
+	int64_t pool_evictions = 0;
+
+	// Editors that still have children to build, processed as a stack a few milliseconds per frame
+	std::vector<ResourceEditor*> build_queue;
+	bool building = false;
+	int64_t builds_finished = 0;
+	int64_t build_slices = 0;
+
+	// Highlights the innermost bordered editor under the mouse, and routes clicks to the editors containing them
+	HoverTracker hover{ this, "_hovered_exiting" };
+
+	SchemaValidator validator;
+	std::vector<ValidationError> errors;
 
 	Variant staging_key;
 	Variant staging_value;
 
+	void _notification(int what);
+	void _input(Ref<InputEvent> event);
+	void _hovered_exiting();
 	void _toggle_editor_visibility();
+	void _release_editor();
+	void _run_build_slice();
+	void _queue_flush();
+	void _deltas_applied(Object* object, String property, Array paths, Array kinds);
+	void _refresh_queued_paths();
+	void _refresh_paths(const Array& paths, const Array& kinds);
+	Object* _get_shown_object();
+	void _update_mixed_paths();
 
 	void _update_btn_text();
+	void _validate(const Variant& value);
+	/// Validates only the parts of `value` that the deltas changed, and replaces their old errors
+	void _revalidate_paths(const Variant& value, const Array& paths, const Array& kinds);
 
 public:
 	static void _register_methods();
 	void _init();
-	void _custom_init(std::unique_ptr<Schema> schema);
+	void _custom_init(std::shared_ptr<const CompiledSchema> schema, const SchemaNode* node, Ref<EditHistory> history);
+
+	/// Edits all of `targets` instead of the edited object, which is a MultiNodeEdit that would give every target the same dictionaries and arrays
+	void set_edit_targets(std::vector<Object*> targets);
+	/// Whether several objects are edited at once
+	bool has_edit_targets() const;
+	/// Whether the edited objects have different values where `editor` is, always false when editing a single object
+	bool is_mixed(const ResourceEditor* editor) const;
+
+	/// While updating, changes made by the editors are not reported, as they come from reading the edited value
+	bool is_updating() const;
+	void set_updating(bool updating);
 
+	/// Schedules the whole edited value to be emitted, edits made within the same coalescing window (or frame) are emitted as one change
 	void emit_something_changed();
+	/// Schedules `delta` to be committed to the edit history, so that undoing it only stores and restores the part that changed.
+	/// Consecutive sets of the same path within the coalescing window are combined, and UndoRedo merges them further into one action.
+	void record_edit(EditDelta delta);
+	/// Schedules `deltas` to be committed as a single undoable action, e.g. a bulk edit of many array elements
+	void record_edits(std::vector<EditDelta> deltas);
+	/// Emits pending edits right away, e.g. when the user presses enter or leaves a field
+	void flush_changes();
+
+	/// Returns a collapsed editor for `node`, reusing one from the pool if possible.
+	/// Reused editors still hold the value they had when released, callers must read() into them.
+	std::pair<Control*, ResourceEditor*> acquire_editor(ResourceEditor* parent, const SchemaNode* node, const Variant& key, bool add_border);
+	/// Detaches the editor acquired for `node` and keeps it for reuse, or frees it if the pool is full
+	void release_editor(Control* control, ResourceEditor* editor, const SchemaNode* node);
+	void clear_editor_pool();
+	/// `{ "pooled": ..., "hits": ..., "misses": ..., "evictions": ..., "hit_rate": ... }`
+	Dictionary get_editor_pool_stats();
+
+	/// Builds the children of `editor` over the next frames, within get_build_budget() milliseconds per frame. Emits "build_finished" once nothing is left.
+	void queue_build(ResourceEditor* editor);
+	/// Stops building `editor` and its descendants, must be called before they are freed or pooled
+	void cancel_build(ResourceEditor* editor);
+	/// `{ "queued": ..., "finished": ..., "slices": ..., "budget_msec": ... }`
+	Dictionary get_build_progress();
 	void update_property();
 
 	ResourceInspectorProperty();
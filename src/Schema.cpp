@@ -1,5 +1,7 @@
 #include "Schema.hpp"
+#include "CompiledSchema.hpp"
 #include "ResourceEditor.hpp"
+#include "Validation.hpp"
 
 #include <CheckBox.hpp>
 #include <Control.hpp>
@@ -9,34 +11,115 @@
 #include <LineEdit.hpp>
 #include <OptionButton.hpp>
 #include <PopupMenu.hpp>
+#include <ProjectSettings.hpp>
 #include <SpinBox.hpp>
 
 using namespace godot;
 using namespace godot::structural_inspector;
 
-StructSchema* StructSchema::clone() const {
-	auto that = new StructSchema();
-	for (auto& [name, field] : fields) {
-		that->fields.push_back({ name, field->clone_uptr() });
+/// Copy of `schema` without its children (struct fields keep their names, but have null definitions)
+static Schema* clone_shallow(const Schema& schema) {
+	switch (schema.kind) {
+		case SchemaKind::STRUCT: {
+			auto& stru = static_cast<const StructSchema&>(schema);
+			auto that = new StructSchema();
+			that->fields.reserve(stru.fields.size());
+			for (auto& field : stru.fields) {
+				that->fields.push_back({ field.name, nullptr });
+			}
+			return that;
+		}
+		case SchemaKind::ARRAY: {
+			auto& array = static_cast<const ArraySchema&>(schema);
+			auto that = new ArraySchema();
+			that->min_elements = array.min_elements;
+			that->max_elements = array.max_elements;
+			return that;
+		}
+		default: {
+			// Leaves, their clone() doesn't recurse
+			return schema.clone();
+		}
+	}
+}
+
+/// Fill in the children of `to`, a clone_shallow() of `from`
+static void clone_children(const Schema& from, Schema& to) {
+	std::vector<std::pair<const Schema*, Schema*>> stack{ { &from, &to } };
+	while (!stack.empty()) {
+		auto [src, dst] = stack.back();
+		stack.pop_back();
+		switch (src->kind) {
+			case SchemaKind::STRUCT: {
+				auto& src_fields = static_cast<const StructSchema*>(src)->fields;
+				auto& dst_fields = static_cast<StructSchema*>(dst)->fields;
+				for (size_t i = 0; i < src_fields.size(); ++i) {
+					dst_fields[i].def.reset(clone_shallow(*src_fields[i].def));
+					stack.push_back({ src_fields[i].def.get(), dst_fields[i].def.get() });
+				}
+			} break;
+			case SchemaKind::ARRAY: {
+				auto& src_element = static_cast<const ArraySchema*>(src)->element_type;
+				auto& dst_element = static_cast<ArraySchema*>(dst)->element_type;
+				dst_element.reset(clone_shallow(*src_element));
+				stack.push_back({ src_element.get(), dst_element.get() });
+			} break;
+			default: break;
+		}
+	}
+}
+
+/// Destroy the children of `schema` one at a time, instead of through a chain of nested destructors
+static void destroy_children(Schema& schema) {
+	std::vector<std::unique_ptr<Schema>> pending;
+	auto take_children = [&](Schema& schema) {
+		switch (schema.kind) {
+			case SchemaKind::STRUCT: {
+				for (auto& field : static_cast<StructSchema&>(schema).fields) {
+					if (field.def) pending.push_back(std::move(field.def));
+				}
+			} break;
+			case SchemaKind::ARRAY: {
+				auto& element = static_cast<ArraySchema&>(schema).element_type;
+				if (element) pending.push_back(std::move(element));
+			} break;
+			default: break;
+		}
+	};
+
+	take_children(schema);
+	while (!pending.empty()) {
+		auto child = std::move(pending.back());
+		pending.pop_back();
+		// `child` has no children left when it is destroyed at the end of this iteration
+		take_children(*child);
 	}
+}
+
+StructSchema::~StructSchema() {
+	destroy_children(*this);
+}
+
+StructSchema* StructSchema::clone() const {
+	auto that = static_cast<StructSchema*>(::clone_shallow(*this));
+	::clone_children(*this, *that);
 	return that;
 }
 
+ArraySchema::~ArraySchema() {
+	destroy_children(*this);
+}
+
 ArraySchema* ArraySchema::clone() const {
-	auto that = new ArraySchema();
-	that->element_type = element_type->clone_uptr();
-	that->min_elements = min_elements;
-	that->max_elements = max_elements;
+	auto that = static_cast<ArraySchema*>(::clone_shallow(*this));
+	::clone_children(*this, *that);
 	return that;
 }
 
 StringSchema* StringSchema::clone() const {
 	auto that = new StringSchema();
-	if (pattern.is_valid()) {
-		that->pattern = Ref{ RegEx::_new() };
-		// Must success, since our pattern is valid
-		that->pattern->compile(pattern->get_pattern());
-	}
+	// Patterns are immutable, so the compiled regex can be shared
+	that->pattern = pattern;
 	return that;
 }
 
@@ -66,20 +149,49 @@ BoolSchema* BoolSchema::clone() const {
 	return new BoolSchema();
 }
 
+RefSchema* RefSchema::clone() const {
+	auto that = new RefSchema();
+	that->target = target;
+	return that;
+}
+
 void ResourceSchema::_register_methods() {
-	register_property("properties", &ResourceSchema::properties, Array{});
+	register_method("validate", &ResourceSchema::validate);
+	register_method("get_fingerprint", &ResourceSchema::get_fingerprint);
+	register_method("get_pattern_cache_stats", &ResourceSchema::get_pattern_cache_stats);
+	register_property<ResourceSchema, Array>("properties", &ResourceSchema::set_properties, &ResourceSchema::get_properties, Array{});
+	register_property<ResourceSchema, Array>("definitions", &ResourceSchema::set_definitions, &ResourceSchema::get_definitions, Array{});
 }
 
 void ResourceSchema::_init() {
 }
 
-std::unordered_map<String, Schema*> ResourceSchema::compute_info() const {
-	std::unordered_map<String, Schema*> info;
+Array ResourceSchema::get_properties() {
+	return properties;
+}
+
+void ResourceSchema::set_properties(Array properties) {
+	this->properties = properties;
+	// Lets anything caching parsed schemas (e.g. InspectorPlugin) know that they are out of date
+	emit_changed();
+}
+
+Array ResourceSchema::get_definitions() {
+	return definitions;
+}
+
+void ResourceSchema::set_definitions(Array definitions) {
+	this->definitions = definitions;
+	emit_changed();
+}
+
+std::unordered_map<String, std::unique_ptr<Schema>> ResourceSchema::compute_info() const {
+	std::unordered_map<String, std::unique_ptr<Schema>> info;
 	for (int i = 0; i < properties.size(); ++i) {
 		Dictionary dict = properties[i];
 		// If parsing schema failed, we skip this entry
 		if (auto schema = ::parse_schema(dict)) {
-			info.insert({ dict["name"], schema.release() });
+			info.insert({ dict["name"], std::move(schema) });
 		} else {
 			ERR_PRINT("Error while parsing schema entry: " + JSON::get_singleton()->print(dict));
 		}
@@ -87,6 +199,44 @@ std::unordered_map<String, Schema*> ResourceSchema::compute_info() const {
 	return info;
 }
 
+static std::vector<StructSchema::Field> parse_schema_list(const Array& list) {
+	std::vector<StructSchema::Field> result;
+	for (int i = 0; i < list.size(); ++i) {
+		Dictionary dict = list[i];
+		// If parsing schema failed, we skip this entry
+		if (auto schema = ::parse_schema(dict)) {
+			result.push_back({ dict["name"], std::move(schema) });
+		} else {
+			ERR_PRINT("Error while parsing schema entry: " + JSON::get_singleton()->print(dict));
+		}
+	}
+	return result;
+}
+
+std::shared_ptr<CompiledSchema> ResourceSchema::compile() const {
+	auto roots = ::parse_schema_list(properties);
+	auto defs = ::parse_schema_list(definitions);
+	return std::make_shared<CompiledSchema>(CompiledSchema::compile(roots, defs));
+}
+
+Array ResourceSchema::validate(Object* object) {
+	auto compiled = compile();
+	SchemaValidator validator;
+	std::vector<ValidationError> errors;
+	for (auto& [name, id] : compiled->get_roots()) {
+		validator.validate(*compiled, compiled->get_node(id), object->get(name), name, errors);
+	}
+	return errors_to_array(errors);
+}
+
+int64_t ResourceSchema::get_fingerprint() {
+	return static_cast<int64_t>(compile()->get_fingerprint());
+}
+
+Dictionary ResourceSchema::get_pattern_cache_stats() {
+	return PatternCache::get_singleton().get_stats();
+}
+
 std::unique_ptr<Schema> ResourceSchema::compute_info_for(const String& prop_name) const {
 	for (int i = 0; i < properties.size(); ++i) {
 		Dictionary dict = properties[i];
@@ -106,29 +256,56 @@ ResourceSchema::ResourceSchema() {
 ResourceSchema::~ResourceSchema() {
 }
 
-std::unique_ptr<Schema> godot::structural_inspector::parse_schema(const Dictionary& def) {
+String godot::structural_inspector::get_schema_path(const String& script_path) {
+	return script_path.substr(0, script_path.find_last(".")) + ".schema.tres";
+}
+
+const char* godot::structural_inspector::MAX_SCHEMA_DEPTH_SETTING = "structural_inspector/max_schema_depth";
+
+int godot::structural_inspector::get_max_schema_depth() {
+	auto settings = ProjectSettings::get_singleton();
+	if (settings->has_setting(MAX_SCHEMA_DEPTH_SETTING)) {
+		int depth = settings->get_setting(MAX_SCHEMA_DEPTH_SETTING);
+		if (depth > 0) {
+			return depth;
+		}
+	}
+	return DEFAULT_MAX_SCHEMA_DEPTH;
+}
+
+/// Parses a single schema node, struct fields and the array element type are left null for parse_schema() to fill in
+static std::unique_ptr<Schema> parse_schema_node(const Dictionary& def) {
 	String type = def["type"];
 	if (type == "struct") {
 		auto schema = std::make_unique<StructSchema>();
 		Array fields = def["fields"];
+		schema->fields.reserve(fields.size());
 		for (int i = 0; i < fields.size(); ++i) {
 			Dictionary property_def = fields[i];
-			schema->fields.push_back({ property_def["name"], parse_schema(property_def) });
+			schema->fields.push_back({ property_def["name"], nullptr });
 		}
 		return schema;
 	} else if (type == "array") {
 		auto schema = std::make_unique<ArraySchema>();
-		schema->element_type = parse_schema(def["element_type"]);
+		// Constraints that are at their default are not saved
+		if (def.has("min_elements")) {
+			schema->min_elements = def["min_elements"];
+		}
+		if (def.has("max_elements")) {
+			schema->max_elements = def["max_elements"];
+		}
 		return schema;
 	} else if (type == "string") {
 		auto schema = std::make_unique<StringSchema>();
 		if (def.has("pattern")) {
 			String pattern = def["pattern"];
-			auto regex = RegEx::_new();
-			if (regex->compile(pattern) != Error::OK) {
-				return nullptr;
+			// An empty pattern matches everything, don't bother compiling it
+			if (!pattern.empty()) {
+				schema->pattern = PatternCache::get_singleton().intern(pattern);
+				if (!schema->pattern) {
+					return nullptr;
+				}
 			}
-			schema->pattern = Ref{ regex };
 		}
 		return schema;
 	} else if (type == "enum") {
@@ -141,62 +318,165 @@ std::unique_ptr<Schema> godot::structural_inspector::parse_schema(const Dictiona
 		return schema;
 	} else if (type == "int") {
 		auto schema = std::make_unique<IntSchema>();
-		schema->min_value = def["min_value"];
-		schema->max_value = def["max_value"];
+		if (def.has("min_value")) {
+			schema->min_value = def["min_value"];
+		}
+		if (def.has("max_value")) {
+			schema->max_value = def["max_value"];
+		}
 		return schema;
 	} else if (type == "float") {
 		auto schema = std::make_unique<FloatSchema>();
-		schema->min_value = def["min_value"];
-		schema->max_value = def["max_value"];
+		if (def.has("min_value")) {
+			schema->min_value = def["min_value"];
+		}
+		if (def.has("max_value")) {
+			schema->max_value = def["max_value"];
+		}
 		return schema;
 	} else if (type == "bool") {
 		return std::make_unique<BoolSchema>();
+	} else if (type == "ref") {
+		auto schema = std::make_unique<RefSchema>();
+		schema->target = def["ref"];
+		if (schema->target.empty()) {
+			return nullptr;
+		}
+		return schema;
 	} else {
 		return nullptr;
 	}
 }
 
+std::unique_ptr<Schema> godot::structural_inspector::parse_schema(const Dictionary& def) {
+	struct Task {
+		Dictionary def;
+		// Where to put the parsed schema, owned by its (already parsed) parent
+		std::unique_ptr<Schema>* out;
+		int depth;
+	};
+
+	int max_depth = get_max_schema_depth();
+	std::unique_ptr<Schema> root;
+	std::vector<Task> stack{ { def, &root, 1 } };
+	while (!stack.empty()) {
+		auto task = std::move(stack.back());
+		stack.pop_back();
+
+		if (task.depth > max_depth) {
+			ERR_PRINT("Schema is nested deeper than " + String::num_int64(max_depth) + " levels, see the " + MAX_SCHEMA_DEPTH_SETTING + " project setting");
+			return nullptr;
+		}
+
+		auto schema = parse_schema_node(task.def);
+		if (!schema) {
+			return nullptr;
+		}
+
+		switch (schema->kind) {
+			case SchemaKind::STRUCT: {
+				auto stru = static_cast<StructSchema*>(schema.get());
+				Array fields = task.def["fields"];
+				// `fields` was sized by parse_schema_node(), so these pointers stay valid
+				for (int i = 0; i < fields.size(); ++i) {
+					stack.push_back({ fields[i], &stru->fields[i].def, task.depth + 1 });
+				}
+			} break;
+			case SchemaKind::ARRAY: {
+				auto array = static_cast<ArraySchema*>(schema.get());
+				stack.push_back({ task.def["element_type"], &array->element_type, task.depth + 1 });
+			} break;
+			default: break;
+		}
+
+		*task.out = std::move(schema);
+	}
+	return root;
+}
+
 Dictionary godot::structural_inspector::save_schema(Schema* schema) {
-	Dictionary property;
-	if (auto stru = dynamic_cast<StructSchema*>(schema)) {
-		Array fields;
-		for (auto& [name, field] : stru->fields) {
-			auto field_dict = save_schema(field.get());
-			field_dict["name"] = name;
-			fields.append(field_dict);
-		}
-		property["type"] = "struct";
-		property["fields"] = fields;
-	} else if (auto array = dynamic_cast<ArraySchema*>(schema)) {
-		property["type"] = "array";
-		property["element_type"] = save_schema(array->element_type.get());
-		property["min_elements"] = array->min_elements;
-		property["max_elements"] = array->max_elements;
-	} else if (auto string = dynamic_cast<StringSchema*>(schema)) {
-		property["type"] = "string";
-		if (string->pattern.is_valid()) {
-			property["pattern"] = string->pattern->get_pattern();
-		}
-	} else if (auto en = dynamic_cast<EnumSchema*>(schema)) {
-		Array values;
-		for (auto& [name, id] : en->elements) {
-			Dictionary value;
-			value["name"] = name;
-			value["id"] = id;
-			values.append(value);
-		}
-		property["type"] = "enum";
-		property["values"] = values;
-	} else if (auto sint = dynamic_cast<IntSchema*>(schema)) {
-		property["type"] = "int";
-		property["min_value"] = sint->min_value;
-		property["max_value"] = sint->max_value;
-	} else if (auto sfloat = dynamic_cast<FloatSchema*>(schema)) {
-		property["type"] = "int";
-		property["min_value"] = sfloat->min_value;
-		property["max_value"] = sfloat->max_value;
-	} else if (auto sbool = dynamic_cast<BoolSchema*>(schema)) {
-		property["type"] = "bool";
+	// Dictionaries and arrays are shared by reference, so children can be filled in after they were added to their parent
+	Dictionary root;
+	std::vector<std::pair<Schema*, Dictionary>> stack{ { schema, root } };
+	while (!stack.empty()) {
+		auto [schema, property] = stack.back();
+		stack.pop_back();
+
+		switch (schema->kind) {
+			case SchemaKind::STRUCT: {
+				auto stru = static_cast<StructSchema*>(schema);
+				Array fields;
+				for (auto& [name, field] : stru->fields) {
+					Dictionary field_dict;
+					field_dict["name"] = name;
+					fields.append(field_dict);
+					stack.push_back({ field.get(), field_dict });
+				}
+				property["type"] = "struct";
+				property["fields"] = fields;
+			} break;
+			case SchemaKind::ARRAY: {
+				auto array = static_cast<ArraySchema*>(schema);
+				Dictionary element_dict;
+				property["type"] = "array";
+				property["element_type"] = element_dict;
+				stack.push_back({ array->element_type.get(), element_dict });
+				// Defaults are omitted, parse_schema() fills them in
+				if (array->min_elements != 0) {
+					property["min_elements"] = array->min_elements;
+				}
+				if (array->max_elements != std::numeric_limits<int>::max()) {
+					property["max_elements"] = array->max_elements;
+				}
+			} break;
+			case SchemaKind::STRING: {
+				auto string = static_cast<StringSchema*>(schema);
+				property["type"] = "string";
+				if (string->pattern) {
+					property["pattern"] = string->pattern->get_source();
+				}
+			} break;
+			case SchemaKind::ENUM: {
+				auto en = static_cast<EnumSchema*>(schema);
+				Array values;
+				for (auto& [name, id] : en->elements) {
+					Dictionary value;
+					value["name"] = name;
+					value["id"] = id;
+					values.append(value);
+				}
+				property["type"] = "enum";
+				property["values"] = values;
+			} break;
+			case SchemaKind::INT: {
+				auto sint = static_cast<IntSchema*>(schema);
+				property["type"] = "int";
+				if (sint->min_value != std::numeric_limits<int>::min()) {
+					property["min_value"] = sint->min_value;
+				}
+				if (sint->max_value != std::numeric_limits<int>::max()) {
+					property["max_value"] = sint->max_value;
+				}
+			} break;
+			case SchemaKind::FLOAT: {
+				auto sfloat = static_cast<FloatSchema*>(schema);
+				property["type"] = "float";
+				if (sfloat->min_value != std::numeric_limits<real_t>::lowest()) {
+					property["min_value"] = sfloat->min_value;
+				}
+				if (sfloat->max_value != std::numeric_limits<real_t>::max()) {
+					property["max_value"] = sfloat->max_value;
+				}
+			} break;
+			case SchemaKind::BOOL: {
+				property["type"] = "bool";
+			} break;
+			case SchemaKind::REF: {
+				auto ref = static_cast<RefSchema*>(schema);
+				property["type"] = "ref";
+				property["ref"] = ref->target;
+			} break;
+		}
 	}
-	return property;
+	return root;
 }
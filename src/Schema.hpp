@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Pattern.hpp"
 #include "Utils.hpp"
 
 #include <Button.hpp>
@@ -10,94 +11,194 @@
 #include <Resource.hpp>
 #include <String.hpp>
 #include <Variant.hpp>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace godot::structural_inspector {
 
 class ResourceInspectorProperty;
+class CompiledSchema;
+
+enum class SchemaKind : uint8_t {
+	STRUCT,
+	ARRAY,
+	STRING,
+	ENUM,
+	INT,
+	FLOAT,
+	BOOL,
+	REF,
+};
+
 class Schema : public CloneProvider<Schema> {
 public:
+	// Explicit tag so that dispatching on the schema type is a switch instead of a chain of dynamic_cast's
+	const SchemaKind kind;
+
+	explicit Schema(SchemaKind kind) :
+			kind{ kind } {}
 	virtual ~Schema() = default;
 };
 
+/// Checked downcast using the kind tag, returns nullptr if `schema` is not a `T`
+template <class T>
+T* schema_cast(Schema* schema) {
+	return schema && schema->kind == T::KIND ? static_cast<T*>(schema) : nullptr;
+}
+
+template <class T>
+const T* schema_cast(const Schema* schema) {
+	return schema && schema->kind == T::KIND ? static_cast<const T*>(schema) : nullptr;
+}
+
 class StructSchema : public Schema, public CloneProvider<StructSchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::STRUCT;
+
 	struct Field {
 		String name;
 		std::unique_ptr<Schema> def;
 	};
 	std::vector<Field> fields;
 
+	StructSchema() :
+			Schema(KIND) {}
+	~StructSchema();
 	StructSchema* clone() const override;
 };
 
 class ArraySchema : public Schema, public CloneProvider<ArraySchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::ARRAY;
+
 	std::unique_ptr<Schema> element_type;
 	int min_elements = 0;
 	int max_elements = std::numeric_limits<int>::max();
 
+	ArraySchema() :
+			Schema(KIND) {}
+	~ArraySchema();
 	ArraySchema* clone() const override;
 };
 
 class StringSchema : public Schema, public CloneProvider<StringSchema> {
 public:
-	Ref<RegEx> pattern;
+	static constexpr SchemaKind KIND = SchemaKind::STRING;
+
+	// nullptr if there is no pattern
+	std::shared_ptr<const Pattern> pattern;
 
+	StringSchema() :
+			Schema(KIND) {}
 	StringSchema* clone() const override;
 };
 
 class EnumSchema : public Schema, public CloneProvider<EnumSchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::ENUM;
+
 	struct EnumValue {
 		String name;
 		int id;
 	};
 	std::vector<EnumValue> elements;
 
+	EnumSchema() :
+			Schema(KIND) {}
 	EnumSchema* clone() const override;
 };
 
 class IntSchema : public Schema, public CloneProvider<IntSchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::INT;
+
 	int min_value = std::numeric_limits<int>::min();
 	int max_value = std::numeric_limits<int>::max();
 
+	IntSchema() :
+			Schema(KIND) {}
 	IntSchema* clone() const override;
 };
 
 class FloatSchema : public Schema, public CloneProvider<FloatSchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::FLOAT;
+
 	// real_t will be either float32 or float64 depending on the compilation options, so this will work
-	real_t min_value = std::numeric_limits<real_t>::min();
+	real_t min_value = std::numeric_limits<real_t>::lowest();
 	real_t max_value = std::numeric_limits<real_t>::max();
 
+	FloatSchema() :
+			Schema(KIND) {}
 	FloatSchema* clone() const override;
 };
 
 class BoolSchema : public Schema, public CloneProvider<BoolSchema> {
 public:
+	static constexpr SchemaKind KIND = SchemaKind::BOOL;
+
+	BoolSchema() :
+			Schema(KIND) {}
 	BoolSchema* clone() const override;
 };
 
+/// Reference to a named entry in ResourceSchema::definitions, resolved when compiling
+class RefSchema : public Schema, public CloneProvider<RefSchema> {
+public:
+	static constexpr SchemaKind KIND = SchemaKind::REF;
+
+	String target;
+
+	RefSchema() :
+			Schema(KIND) {}
+	RefSchema* clone() const override;
+};
+
 class ResourceSchema : public Resource {
 	GODOT_CLASS(ResourceSchema, Resource)
 public:
 	Array properties;
+	/// Named schemas that can be used anywhere in `properties` (or other definitions) with `{ "type": "ref", "ref": name }`
+	Array definitions;
 
 public:
 	static void _register_methods();
 	void _init();
 
-	std::unordered_map<String, Schema*> compute_info() const;
+	Array get_properties();
+	void set_properties(Array properties);
+	Array get_definitions();
+	void set_definitions(Array definitions);
+
+	std::unordered_map<String, std::unique_ptr<Schema>> compute_info() const;
 	std::unique_ptr<Schema> compute_info_for(const String& prop_name) const;
+	/// Parse and compile all properties into one CompiledSchema, with each property as a named root.
+	/// Each definition is parsed once, regardless of how many times it is referenced.
+	std::shared_ptr<CompiledSchema> compile() const;
+	/// Validate the properties of `object` against this schema, returns an Array of `{ "path": ..., "message": ... }`
+	Array validate(Object* object);
+	/// Structural fingerprint of the compiled schema, see CompiledSchema::get_fingerprint()
+	int64_t get_fingerprint();
+	/// Statistics of the process-wide pattern intern table, see PatternCache::get_stats()
+	Dictionary get_pattern_cache_stats();
 
 	ResourceSchema();
 	~ResourceSchema();
 };
 
+/// `res://foo/Bar.gd` -> `res://foo/Bar.schema.tres`
+String get_schema_path(const String& script_path);
+
+/// Project setting for the deepest nesting of struct/array schemas that parse_schema() accepts
+extern const char* MAX_SCHEMA_DEPTH_SETTING;
+static constexpr int DEFAULT_MAX_SCHEMA_DEPTH = 1024;
+int get_max_schema_depth();
+
+/// Returns nullptr if `def` (or anything nested in it) is invalid, or nests deeper than get_max_schema_depth().
+/// All traversals of schema trees use explicit work stacks, so deep schemas don't overflow the native stack.
 std::unique_ptr<Schema> parse_schema(const Dictionary& def);
 Dictionary save_schema(Schema* schema);
 
@@ -0,0 +1,465 @@
+#include "SchemaBinary.hpp"
+
+#include <Directory.hpp>
+#include <File.hpp>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+// Layout, all integers are unsigned LEB128 varints unless noted, signed ones zigzag encoded:
+//
+// magic "SISB" (4 bytes)
+// version
+// source modified time, fingerprint (8 bytes little endian each)
+// string table: count, then per string: length, code points
+// nodes: count, then per node:
+//   kind (1 byte), flags (1 byte), first, count, fingerprint (8 bytes LE)
+//   ARRAY/INT: min, max (signed), each only if its flag is set, i.e. when it is not the default
+//   FLOAT: min, max (8 bytes LE double), each only if its flag is set
+//   STRING: pattern index, only if FLAG_HAS_PATTERN is set
+//   REF: no payload, recursion is a flag
+// fields: count, then per field: name (string index), node
+// enum values: count, then per value: name (string index), id (signed)
+// patterns: count, then per pattern: source (string index)
+// roots: count, then per root: name (string index), node
+// refs: count, then per ref: name (string index), node
+
+static const char MAGIC[4] = { 'S', 'I', 'S', 'B' };
+static const uint64_t VERSION = 2;
+
+enum NodeFlags : uint8_t {
+	FLAG_HAS_MIN = 1 << 0,
+	FLAG_HAS_MAX = 1 << 1,
+	FLAG_HAS_PATTERN = 1 << 2,
+	FLAG_RECURSIVE = 1 << 3,
+};
+
+namespace {
+
+class Writer {
+public:
+	std::vector<uint8_t> buffer;
+	std::unordered_map<String, uint64_t> string_ids;
+	std::vector<const String*> strings;
+
+	void byte(uint8_t value) {
+		buffer.push_back(value);
+	}
+
+	void fixed64(uint64_t value) {
+		for (int i = 0; i < 8; ++i) {
+			buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void varint(uint64_t value) {
+		while (value >= 0x80) {
+			buffer.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back(static_cast<uint8_t>(value));
+	}
+
+	void signed_varint(int64_t value) {
+		varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+	}
+
+	void real(double value) {
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		fixed64(bits);
+	}
+
+	/// Strings are interned, so that e.g. field names repeated across structs are stored once
+	uint64_t string_id(const String& string) {
+		auto [it, inserted] = string_ids.insert({ string, strings.size() });
+		if (inserted) {
+			strings.push_back(&it->first);
+		}
+		return it->second;
+	}
+
+	void string(const String& string) {
+		auto chars = string.unicode_str();
+		varint(string.length());
+		for (int i = 0; i < string.length(); ++i) {
+			varint(static_cast<uint32_t>(chars[i]));
+		}
+	}
+};
+
+class Reader {
+public:
+	const uint8_t* data;
+	size_t size;
+	size_t pos = 0;
+	bool failed = false;
+
+	Reader(const uint8_t* data, size_t size) :
+			data{ data }, size{ size } {}
+
+	uint8_t byte() {
+		if (pos >= size) {
+			failed = true;
+			return 0;
+		}
+		return data[pos++];
+	}
+
+	uint64_t fixed64() {
+		uint64_t value = 0;
+		for (int i = 0; i < 8; ++i) {
+			value |= static_cast<uint64_t>(byte()) << (i * 8);
+		}
+		return value;
+	}
+
+	uint64_t varint() {
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			auto b = byte();
+			value |= static_cast<uint64_t>(b & 0x7F) << shift;
+			if (!(b & 0x80)) {
+				return value;
+			}
+		}
+		failed = true;
+		return 0;
+	}
+
+	int64_t signed_varint() {
+		auto value = varint();
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	double real() {
+		auto bits = fixed64();
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	/// Reads a count, and fails if there can't be that many entries of at least `min_entry_size` bytes left
+	uint32_t count(size_t min_entry_size = 1) {
+		auto value = varint();
+		if (value > (size - pos) / min_entry_size) {
+			failed = true;
+			return 0;
+		}
+		return static_cast<uint32_t>(value);
+	}
+
+	String string() {
+		auto length = count();
+		std::wstring chars;
+		chars.reserve(length);
+		for (uint32_t i = 0; i < length && !failed; ++i) {
+			chars.push_back(static_cast<wchar_t>(varint()));
+		}
+		return String{ chars.c_str() };
+	}
+};
+
+} // namespace
+
+String godot::structural_inspector::get_schema_binary_path(const String& schema_path) {
+	return "res://.import/" + schema_path.get_file() + "-" + schema_path.md5_text() + ".schemabin";
+}
+
+PoolByteArray godot::structural_inspector::write_schema_binary(const CompiledSchema& schema, uint64_t source_modified_time) {
+	// The body is written first so that the string table can be collected on the way, the header and string table are prepended at the end
+	Writer body;
+
+	body.varint(schema.nodes.size());
+	for (auto& node : schema.nodes) {
+		uint8_t flags = 0;
+		switch (node.kind) {
+			case SchemaKind::ARRAY: {
+				flags |= node.array.min_elements != 0 ? FLAG_HAS_MIN : 0;
+				flags |= node.array.max_elements != std::numeric_limits<int>::max() ? FLAG_HAS_MAX : 0;
+			} break;
+			case SchemaKind::INT: {
+				flags |= node.int_range.min_value != std::numeric_limits<int>::min() ? FLAG_HAS_MIN : 0;
+				flags |= node.int_range.max_value != std::numeric_limits<int>::max() ? FLAG_HAS_MAX : 0;
+			} break;
+			case SchemaKind::FLOAT: {
+				flags |= node.float_range.min_value != std::numeric_limits<real_t>::lowest() ? FLAG_HAS_MIN : 0;
+				flags |= node.float_range.max_value != std::numeric_limits<real_t>::max() ? FLAG_HAS_MAX : 0;
+			} break;
+			case SchemaKind::STRING: {
+				flags |= node.string.pattern != CompiledSchema::NO_PATTERN ? FLAG_HAS_PATTERN : 0;
+			} break;
+			case SchemaKind::REF: {
+				flags |= node.ref.recursive ? FLAG_RECURSIVE : 0;
+			} break;
+			default: break;
+		}
+
+		body.byte(static_cast<uint8_t>(node.kind));
+		body.byte(flags);
+		body.varint(node.first);
+		body.varint(node.count);
+		body.fixed64(node.fingerprint);
+		switch (node.kind) {
+			case SchemaKind::ARRAY: {
+				if (flags & FLAG_HAS_MIN) body.signed_varint(node.array.min_elements);
+				if (flags & FLAG_HAS_MAX) body.signed_varint(node.array.max_elements);
+			} break;
+			case SchemaKind::INT: {
+				if (flags & FLAG_HAS_MIN) body.signed_varint(node.int_range.min_value);
+				if (flags & FLAG_HAS_MAX) body.signed_varint(node.int_range.max_value);
+			} break;
+			case SchemaKind::FLOAT: {
+				if (flags & FLAG_HAS_MIN) body.real(node.float_range.min_value);
+				if (flags & FLAG_HAS_MAX) body.real(node.float_range.max_value);
+			} break;
+			case SchemaKind::STRING: {
+				if (flags & FLAG_HAS_PATTERN) body.varint(node.string.pattern);
+			} break;
+			default: break;
+		}
+	}
+
+	body.varint(schema.fields.size());
+	for (auto& field : schema.fields) {
+		body.varint(body.string_id(field.name));
+		body.varint(field.node);
+	}
+
+	body.varint(schema.enum_values.size());
+	for (auto& value : schema.enum_values) {
+		body.varint(body.string_id(value.name));
+		body.signed_varint(value.id);
+	}
+
+	body.varint(schema.patterns.size());
+	for (auto& pattern : schema.patterns) {
+		body.varint(body.string_id(pattern->get_source()));
+	}
+
+	body.varint(schema.roots.size());
+	for (auto& [name, id] : schema.roots) {
+		body.varint(body.string_id(name));
+		body.varint(id);
+	}
+
+	body.varint(schema.ref_nodes.size());
+	for (auto& [name, id] : schema.ref_nodes) {
+		body.varint(body.string_id(name));
+		body.varint(id);
+	}
+
+	Writer header;
+	for (auto c : MAGIC) {
+		header.byte(c);
+	}
+	header.varint(VERSION);
+	header.fixed64(source_modified_time);
+	header.fixed64(schema.fingerprint);
+	header.varint(body.strings.size());
+	for (auto string : body.strings) {
+		header.string(*string);
+	}
+
+	PoolByteArray result;
+	result.resize(header.buffer.size() + body.buffer.size());
+	{
+		auto write = result.write();
+		std::memcpy(write.ptr(), header.buffer.data(), header.buffer.size());
+		std::memcpy(write.ptr() + header.buffer.size(), body.buffer.data(), body.buffer.size());
+	}
+	return result;
+}
+
+std::shared_ptr<CompiledSchema> godot::structural_inspector::read_schema_binary(const PoolByteArray& data, uint64_t source_modified_time) {
+	auto read = data.read();
+	Reader reader{ read.ptr(), static_cast<size_t>(data.size()) };
+
+	for (auto c : MAGIC) {
+		if (reader.byte() != static_cast<uint8_t>(c)) {
+			return nullptr;
+		}
+	}
+	if (reader.varint() != VERSION || reader.fixed64() != source_modified_time) {
+		return nullptr;
+	}
+
+	auto compiled = std::make_shared<CompiledSchema>();
+	compiled->fingerprint = reader.fixed64();
+
+	std::vector<String> strings;
+	strings.resize(reader.count());
+	for (auto& string : strings) {
+		string = reader.string();
+	}
+	auto string_at = [&](uint64_t idx) -> const String& {
+		if (idx >= strings.size()) {
+			reader.failed = true;
+			static const String empty;
+			return empty;
+		}
+		return strings[idx];
+	};
+
+	// Smallest possible encoded node: kind, flags, first, count and the fingerprint
+	compiled->nodes.resize(reader.count(12));
+	for (auto& node : compiled->nodes) {
+		auto kind = reader.byte();
+		if (kind > static_cast<uint8_t>(SchemaKind::REF)) {
+			return nullptr;
+		}
+		node.kind = static_cast<SchemaKind>(kind);
+		auto flags = reader.byte();
+		node.first = reader.varint();
+		node.count = reader.varint();
+		node.fingerprint = reader.fixed64();
+		switch (node.kind) {
+			case SchemaKind::ARRAY: {
+				node.array.min_elements = flags & FLAG_HAS_MIN ? reader.signed_varint() : 0;
+				node.array.max_elements = flags & FLAG_HAS_MAX ? reader.signed_varint() : std::numeric_limits<int>::max();
+			} break;
+			case SchemaKind::INT: {
+				node.int_range.min_value = flags & FLAG_HAS_MIN ? reader.signed_varint() : std::numeric_limits<int>::min();
+				node.int_range.max_value = flags & FLAG_HAS_MAX ? reader.signed_varint() : std::numeric_limits<int>::max();
+			} break;
+			case SchemaKind::FLOAT: {
+				node.float_range.min_value = flags & FLAG_HAS_MIN ? reader.real() : std::numeric_limits<real_t>::lowest();
+				node.float_range.max_value = flags & FLAG_HAS_MAX ? reader.real() : std::numeric_limits<real_t>::max();
+			} break;
+			case SchemaKind::STRING: {
+				node.string.pattern = flags & FLAG_HAS_PATTERN ? reader.varint() : CompiledSchema::NO_PATTERN;
+			} break;
+			case SchemaKind::REF: {
+				node.ref.recursive = flags & FLAG_RECURSIVE;
+			} break;
+			default: break;
+		}
+	}
+
+	compiled->fields.resize(reader.count(2));
+	for (auto& field : compiled->fields) {
+		field.name = string_at(reader.varint());
+		field.node = reader.varint();
+	}
+
+	compiled->enum_values.resize(reader.count(2));
+	for (auto& value : compiled->enum_values) {
+		value.name = string_at(reader.varint());
+		value.id = reader.signed_varint();
+	}
+
+	compiled->patterns.resize(reader.count());
+	for (auto& pattern : compiled->patterns) {
+		// Interning makes this cheap when other schemas use the same patterns
+		pattern = PatternCache::get_singleton().intern(string_at(reader.varint()));
+		if (!pattern) {
+			return nullptr;
+		}
+	}
+
+	auto root_count = reader.count(2);
+	for (uint32_t i = 0; i < root_count && !reader.failed; ++i) {
+		auto& name = string_at(reader.varint());
+		compiled->roots.insert({ name, static_cast<SchemaNodeId>(reader.varint()) });
+	}
+
+	auto ref_count = reader.count(2);
+	for (uint32_t i = 0; i < ref_count && !reader.failed; ++i) {
+		auto& name = string_at(reader.varint());
+		compiled->ref_nodes.insert({ name, static_cast<SchemaNodeId>(reader.varint()) });
+	}
+
+	if (reader.failed || reader.pos != reader.size) {
+		return nullptr;
+	}
+
+	// Don't trust the indices, a corrupted blob must not make the editors read out of bounds
+	auto node_count = compiled->nodes.size();
+	for (auto& node : compiled->nodes) {
+		switch (node.kind) {
+			case SchemaKind::STRUCT:
+			case SchemaKind::ARRAY:
+			case SchemaKind::REF: {
+				if (node.first + static_cast<uint64_t>(node.count) > compiled->fields.size()) return nullptr;
+				if (node.kind != SchemaKind::STRUCT && node.count != 1) return nullptr;
+			} break;
+			case SchemaKind::ENUM: {
+				if (node.first + static_cast<uint64_t>(node.count) > compiled->enum_values.size()) return nullptr;
+			} break;
+			case SchemaKind::STRING: {
+				if (node.string.pattern != CompiledSchema::NO_PATTERN && node.string.pattern >= compiled->patterns.size()) return nullptr;
+			} break;
+			default: break;
+		}
+	}
+	for (auto& field : compiled->fields) {
+		// Only unresolved references have NO_NODE, the loop below checks that
+		if (field.node >= node_count && field.node != CompiledSchema::NO_NODE) return nullptr;
+	}
+	for (auto& node : compiled->nodes) {
+		if (node.kind == SchemaKind::STRUCT || node.kind == SchemaKind::ARRAY) {
+			for (uint32_t i = 0; i < node.count; ++i) {
+				if (compiled->fields[node.first + i].node == CompiledSchema::NO_NODE) return nullptr;
+			}
+		}
+	}
+	for (auto& [name, id] : compiled->roots) {
+		if (id >= node_count) return nullptr;
+	}
+	for (auto& [name, id] : compiled->ref_nodes) {
+		if (id >= node_count || compiled->nodes[id].kind != SchemaKind::REF) return nullptr;
+	}
+
+	return compiled;
+}
+
+bool godot::structural_inspector::save_schema_binary(const String& schema_path, const CompiledSchema& schema) {
+	auto file = Ref{ File::_new() };
+	auto modified_time = file->get_modified_time(schema_path);
+	auto binary_path = get_schema_binary_path(schema_path);
+
+	auto dir = Ref{ Directory::_new() };
+	if (!dir->dir_exists(binary_path.get_base_dir())) {
+		dir->make_dir_recursive(binary_path.get_base_dir());
+	}
+
+	// Both the loader thread and the main thread save blobs, and load_schema_binary() may read one at any time. Each write goes to its own
+	// temporary file which is then renamed over the blob, so readers see either the old blob or the new one but never a partial write.
+	static std::atomic<uint64_t> next_temp_id{ 0 };
+	auto temp_path = binary_path + ".tmp" + String::num_int64(next_temp_id++);
+	if (file->open(temp_path, File::WRITE) != Error::OK) {
+		ERR_PRINT("Failed to write compiled schema " + binary_path);
+		return false;
+	}
+	file->store_buffer(write_schema_binary(schema, modified_time));
+	file->close();
+
+	if (dir->open(binary_path.get_base_dir()) != Error::OK || dir->rename(temp_path, binary_path) != Error::OK) {
+		ERR_PRINT("Failed to write compiled schema " + binary_path);
+		dir->remove(temp_path);
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<CompiledSchema> godot::structural_inspector::load_schema_binary(const String& schema_path) {
+	auto file = Ref{ File::_new() };
+	auto binary_path = get_schema_binary_path(schema_path);
+	if (!file->file_exists(binary_path) || !file->file_exists(schema_path)) {
+		return nullptr;
+	}
+
+	auto modified_time = file->get_modified_time(schema_path);
+	if (file->open(binary_path, File::READ) != Error::OK) {
+		return nullptr;
+	}
+	auto data = file->get_buffer(file->get_len());
+	file->close();
+	return read_schema_binary(data, modified_time);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CompiledSchema.hpp"
+
+#include <Godot.hpp>
+#include <PoolArrays.hpp>
+#include <String.hpp>
+#include <cstdint>
+#include <memory>
+
+namespace godot::structural_inspector {
+
+/// `res://foo/Bar.schema.tres` -> `res://.import/Bar.schema.tres-<md5 of the path>.schemabin`, next to Godot's own import artifacts
+String get_schema_binary_path(const String& schema_path);
+
+/// Serialize to the binary schema format, see SchemaBinary.cpp for the layout.
+/// `source_modified_time` is the modification time of the schema file the blob was compiled from, used to detect stale blobs.
+PoolByteArray write_schema_binary(const CompiledSchema& schema, uint64_t source_modified_time);
+/// Returns nullptr if `data` is not a valid blob, or was compiled from a different version of the source file
+std::shared_ptr<CompiledSchema> read_schema_binary(const PoolByteArray& data, uint64_t source_modified_time);
+
+/// Compile step run when a schema is saved, writes the blob to get_schema_binary_path(schema_path)
+bool save_schema_binary(const String& schema_path, const CompiledSchema& schema);
+/// Load the blob for `schema_path` if there is an up to date one, without loading the schema resource itself.
+/// Returns nullptr if the blob is missing or stale, callers should fall back to ResourceSchema::compile().
+std::shared_ptr<CompiledSchema> load_schema_binary(const String& schema_path);
+
+} // namespace godot::structural_inspector
@@ -96,10 +96,6 @@ static VBoxContainer* create_enum_value_edit(const String& name, int id, Object*
 	return enum_value;
 }
 
-bool ResourceSchemaEditor::_is_mouse_inside() {
-	return get_global_rect().has_point(get_global_mouse_position());
-}
-
 void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 	if (schema_id == id) {
 		return;
@@ -146,6 +142,9 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 		case BOOL: {
 			// Do nothing
 		} break;
+		case REF: {
+			::get_nc_line(ref_name)->set_visible(false);
+		} break;
 		default: {
 			// Do nothing, for schema_id == UNKNOWN
 		} break;
@@ -174,7 +173,7 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 			ArraySchema* array;
 			if (swap_out != this->definition.get_schema().get()) {
 				if (swap_out) {
-					array = dynamic_cast<ArraySchema*>(swap_out);
+					array = schema_cast<ArraySchema>(swap_out);
 				} else {
 					array = new ArraySchema();
 					array->element_type = std::make_unique<StructSchema>();
@@ -183,7 +182,7 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 				definition.get_schema().reset(array);
 				schema_id = ARRAY;
 			} else {
-				array = dynamic_cast<ArraySchema*>(this->definition.get_schema().get());
+				array = schema_cast<ArraySchema>(this->definition.get_schema().get());
 			}
 
 			auto child = ResourceSchemaEditor::_new();
@@ -221,11 +220,11 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 
 			IntSchema* sint;
 			if (swap_out != this->definition.get_schema().get()) {
-				sint = swap_out ? dynamic_cast<IntSchema*>(swap_out) : new IntSchema();
+				sint = swap_out ? schema_cast<IntSchema>(swap_out) : new IntSchema();
 				definition.get_schema().reset(sint);
 				schema_id = INT;
 			} else {
-				sint = dynamic_cast<IntSchema*>(this->definition.get_schema().get());
+				sint = schema_cast<IntSchema>(this->definition.get_schema().get());
 			}
 
 			min_value->set_value(sint->min_value);
@@ -239,11 +238,11 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 
 			FloatSchema* sfloat;
 			if (swap_out != this->definition.get_schema().get()) {
-				auto sfloat = swap_out ? dynamic_cast<FloatSchema*>(swap_out) : new FloatSchema();
+				sfloat = swap_out ? schema_cast<FloatSchema>(swap_out) : new FloatSchema();
 				definition.get_schema().reset(sfloat);
 				schema_id = FLOAT;
 			} else {
-				sfloat = dynamic_cast<FloatSchema*>(this->definition.get_schema().get());
+				sfloat = schema_cast<FloatSchema>(this->definition.get_schema().get());
 			}
 
 			min_value->set_value(sfloat->min_value);
@@ -255,6 +254,14 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 				schema_id = BOOL;
 			}
 		} break;
+		case REF: {
+			::get_nc_line(ref_name)->set_visible(true);
+
+			if (swap_out != this->definition.get_schema().get()) {
+				definition.get_schema().reset(swap_out ? swap_out : new RefSchema());
+				schema_id = REF;
+			}
+		} break;
 		default: {
 			definition.get_schema() = nullptr;
 			schema_id = UNKNOWN;
@@ -269,29 +276,13 @@ void ResourceSchemaEditor::_select_type(int id, Schema* swap_out) {
 Variant ResourceSchemaEditor::_get_key() {
 	if (field_name->is_visible()) {
 		return field_name->get_text();
-	} else if (auto parent_schema = dynamic_cast<ArraySchema*>(parent->get_schema())) {
+	} else if (parent && parent->get_schema()->kind == SchemaKind::ARRAY) {
 		return get_index();
 	} else {
 		return Variant{};
 	}
 }
 
-void ResourceSchemaEditor::_input(Ref<InputEvent> event) {
-	if (auto mb = Object::cast_to<InputEventMouseButton>(event.ptr())) {
-		if (mb->get_button_index() == GlobalConstants::BUTTON_LEFT && mb->is_pressed() && _is_mouse_inside()) {
-			emit_signal("clicked");
-		}
-		return;
-	}
-	if (auto mm = Object::cast_to<InputEventMouseMotion>(event.ptr())) {
-		if (bool current = _is_mouse_inside(); mouse_inside != current) {
-			mouse_inside = current;
-			update();
-		}
-		return;
-	}
-}
-
 void ResourceSchemaEditor::_notification(int what) {
 	switch (what) {
 		case NOTIFICATION_READY: {
@@ -300,67 +291,93 @@ void ResourceSchemaEditor::_notification(int what) {
 				field_name->set_text(definition.get_name());
 			}
 
-			if (auto other = dynamic_cast<StructSchema*>(definition.get_schema().get())) {
-				// Update UI nodes to the correct layout only, this will not update `this->schema`
-				_select_type(STRUCT, other);
-				type_edit->select(STRUCT);
+			auto schema = definition.get_schema().get();
+			if (!schema) {
+				break;
+			}
+			switch (schema->kind) {
+				case SchemaKind::STRUCT: {
+					auto other = static_cast<StructSchema*>(schema);
+					// Update UI nodes to the correct layout only, this will not update `this->schema`
+					_select_type(STRUCT, other);
+					type_edit->select(STRUCT);
+
+					for (int i = 0; i < list->get_child_count(); ++i) {
+						list->get_child(i)->free();
+					}
+					for (int i = 0; i < other->fields.size(); ++i) {
+						auto child = ResourceSchemaEditor::_new();
+						child->_custom_init(root, this, { &other->fields, static_cast<size_t>(i) });
+						child->connect("clicked", this, "_child_clicked", Array::make(child));
+						list->add_child(child);
+					}
+				} break;
+				case SchemaKind::ARRAY: {
+					auto other = static_cast<ArraySchema*>(schema);
+					_select_type(ARRAY, other);
+					type_edit->select(ARRAY);
+
+					min_value->set_value(other->min_elements);
+					max_value->set_value(other->max_elements);
+
+					if (list->get_child_count() > 0) {
+						get_child_node(0)->free();
+					}
 
-				for (int i = 0; i < list->get_child_count(); ++i) {
-					list->get_child(i)->free();
-				}
-				for (int i = 0; i < other->fields.size(); ++i) {
 					auto child = ResourceSchemaEditor::_new();
-					child->_custom_init(root, this, { &other->fields, static_cast<size_t>(i) });
+					child->_custom_init(root, this, { &other->element_type });
 					child->connect("clicked", this, "_child_clicked", Array::make(child));
 					list->add_child(child);
-				}
-			} else if (auto other = dynamic_cast<ArraySchema*>(definition.get_schema().get())) {
-				_select_type(ARRAY, other);
-				type_edit->select(ARRAY);
-
-				min_value->set_value(other->min_elements);
-				max_value->set_value(other->max_elements);
-
-				if (list->get_child_count() > 0) {
-					get_child_node(0)->free();
-				}
-
-				auto child = ResourceSchemaEditor::_new();
-				child->_custom_init(root, this, { &other->element_type });
-				child->connect("clicked", this, "_child_clicked", Array::make(child));
-				list->add_child(child);
-			} else if (auto other = dynamic_cast<StringSchema*>(definition.get_schema().get())) {
-				_select_type(STRING, other);
-				type_edit->select(STRING);
-
-				if (other->pattern.is_valid()) {
-					pattern->set_text(other->pattern->get_pattern());
-				}
-			} else if (auto other = dynamic_cast<EnumSchema*>(definition.get_schema().get())) {
-				_select_type(ENUM, other);
-				type_edit->select(ENUM);
-
-				for (int i = 0; i < list->get_child_count(); ++i) {
-					list->get_child(i)->free();
-				}
-				for (auto& [name, id] : other->elements) {
-					list->add_child(::create_enum_value_edit(name, id, this));
-				}
-			} else if (auto other = dynamic_cast<IntSchema*>(definition.get_schema().get())) {
-				_select_type(INT, other);
-				type_edit->select(INT);
-
-				min_value->set_value(other->min_value);
-				max_value->set_value(other->max_value);
-			} else if (auto other = dynamic_cast<FloatSchema*>(definition.get_schema().get())) {
-				_select_type(FLOAT, other);
-				type_edit->select(FLOAT);
-
-				min_value->set_value(other->min_value);
-				max_value->set_value(other->max_value);
-			} else if (auto other = dynamic_cast<BoolSchema*>(definition.get_schema().get())) {
-				_select_type(BOOL, other);
-				type_edit->select(BOOL);
+				} break;
+				case SchemaKind::STRING: {
+					auto other = static_cast<StringSchema*>(schema);
+					_select_type(STRING, other);
+					type_edit->select(STRING);
+
+					if (other->pattern) {
+						pattern->set_text(other->pattern->get_source());
+					}
+				} break;
+				case SchemaKind::ENUM: {
+					auto other = static_cast<EnumSchema*>(schema);
+					_select_type(ENUM, other);
+					type_edit->select(ENUM);
+
+					for (int i = 0; i < list->get_child_count(); ++i) {
+						list->get_child(i)->free();
+					}
+					for (auto& [name, id] : other->elements) {
+						list->add_child(::create_enum_value_edit(name, id, this));
+					}
+				} break;
+				case SchemaKind::INT: {
+					auto other = static_cast<IntSchema*>(schema);
+					_select_type(INT, other);
+					type_edit->select(INT);
+
+					min_value->set_value(other->min_value);
+					max_value->set_value(other->max_value);
+				} break;
+				case SchemaKind::FLOAT: {
+					auto other = static_cast<FloatSchema*>(schema);
+					_select_type(FLOAT, other);
+					type_edit->select(FLOAT);
+
+					min_value->set_value(other->min_value);
+					max_value->set_value(other->max_value);
+				} break;
+				case SchemaKind::BOOL: {
+					auto other = static_cast<BoolSchema*>(schema);
+					_select_type(BOOL, other);
+					type_edit->select(BOOL);
+				} break;
+				case SchemaKind::REF: {
+					auto other = static_cast<RefSchema*>(schema);
+					_select_type(REF, other);
+					type_edit->select(REF);
+
+					ref_name->set_text(other->target);
+				} break;
 			}
 		} break;
 
@@ -370,7 +387,7 @@ void ResourceSchemaEditor::_notification(int what) {
 		case NOTIFICATION_DRAW: {
 			// First is regular border color, second is hovered border color
 			static const Color colors[] = { Color::hex(0x262C3BFF), Color::hex(0x333B4FFF) };
-			draw_rect(Rect2{ 4, 4, get_size().x - 4 * 2, get_size().y - 4 * 2 }, colors[mouse_inside], false, 2.0F);
+			draw_rect(Rect2{ 4, 4, get_size().x - 4 * 2, get_size().y - 4 * 2 }, colors[hovered], false, 2.0F);
 		} break;
 		default: {
 		} break;
@@ -384,7 +401,7 @@ void ResourceSchemaEditor::_type_selected(int id) {
 void ResourceSchemaEditor::_add_list_item() {
 	switch (schema_id) {
 		case STRUCT: {
-			auto schema = dynamic_cast<StructSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<StructSchema>(this->definition.get_schema().get());
 			int idx = schema->fields.size();
 			schema->fields.push_back({ "", std::make_unique<StructSchema>() });
 
@@ -397,7 +414,7 @@ void ResourceSchemaEditor::_add_list_item() {
 		} break;
 		case ENUM: {
 			int idx = list->get_child_count(); // Is equal to `enum_value->get_index()`
-			auto schema = dynamic_cast<EnumSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<EnumSchema>(this->definition.get_schema().get());
 			// Default ID is its index
 			schema->elements.push_back({ "", idx });
 
@@ -442,17 +459,17 @@ void ResourceSchemaEditor::_field_name_set(const String& name) {
 void ResourceSchemaEditor::_min_value_set(real_t value) {
 	switch (schema_id) {
 		case ARRAY: {
-			auto schema = dynamic_cast<ArraySchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<ArraySchema>(this->definition.get_schema().get());
 			schema->min_elements = static_cast<int>(value);
 			root->emit_something_changed();
 		} break;
 		case INT: {
-			auto schema = dynamic_cast<IntSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<IntSchema>(this->definition.get_schema().get());
 			schema->min_value = static_cast<int>(value);
 			root->emit_something_changed();
 		} break;
 		case FLOAT: {
-			auto schema = dynamic_cast<FloatSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<FloatSchema>(this->definition.get_schema().get());
 			schema->min_value = value;
 			root->emit_something_changed();
 		} break;
@@ -465,17 +482,17 @@ void ResourceSchemaEditor::_min_value_set(real_t value) {
 void ResourceSchemaEditor::_max_value_set(real_t value) {
 	switch (schema_id) {
 		case ARRAY: {
-			auto schema = dynamic_cast<ArraySchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<ArraySchema>(this->definition.get_schema().get());
 			schema->max_elements = static_cast<int>(value);
 			root->emit_something_changed();
 		} break;
 		case INT: {
-			auto schema = dynamic_cast<IntSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<IntSchema>(this->definition.get_schema().get());
 			schema->max_value = static_cast<int>(value);
 			root->emit_something_changed();
 		} break;
 		case FLOAT: {
-			auto schema = dynamic_cast<FloatSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<FloatSchema>(this->definition.get_schema().get());
 			schema->max_value = value;
 			root->emit_something_changed();
 		} break;
@@ -488,8 +505,22 @@ void ResourceSchemaEditor::_max_value_set(real_t value) {
 void ResourceSchemaEditor::_pattern_set(const String& pattern) {
 	switch (schema_id) {
 		case STRING: {
-			auto schema = dynamic_cast<StringSchema*>(this->definition.get_schema().get());
-			schema->pattern = Ref{ RegEx::_new() };
+			auto schema = schema_cast<StringSchema>(this->definition.get_schema().get());
+			// Invalid patterns (e.g. while still being typed) are dropped, as parse_schema() would reject them anyway
+			schema->pattern = pattern.empty() ? nullptr : PatternCache::get_singleton().intern(pattern);
+			root->emit_something_changed();
+		} break;
+		default: {
+			return;
+		}
+	}
+}
+
+void ResourceSchemaEditor::_ref_name_set(const String& name) {
+	switch (schema_id) {
+		case REF: {
+			auto schema = schema_cast<RefSchema>(this->definition.get_schema().get());
+			schema->target = name;
 			root->emit_something_changed();
 		} break;
 		default: {
@@ -506,13 +537,13 @@ void ResourceSchemaEditor::_child_clicked(ResourceSchemaEditor* child) {
 	bool removed = false;
 	switch (schema_id) {
 		case STRUCT: {
-			auto schema = dynamic_cast<StructSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<StructSchema>(this->definition.get_schema().get());
 			child->queue_free();
 			schema->fields.erase(schema->fields.begin() + child->get_index());
 			removed = true;
 		} break;
 		case ENUM: {
-			auto schema = dynamic_cast<EnumSchema*>(this->definition.get_schema().get());
+			auto schema = schema_cast<EnumSchema>(this->definition.get_schema().get());
 			child->queue_free();
 			schema->elements.erase(schema->elements.begin() + child->get_index());
 			removed = true;
@@ -533,14 +564,14 @@ void ResourceSchemaEditor::_child_clicked(ResourceSchemaEditor* child) {
 }
 
 void ResourceSchemaEditor::_enum_name_set(const String& name, Control* child) {
-	if (auto schema = dynamic_cast<EnumSchema*>(this->definition.get_schema().get())) {
+	if (auto schema = schema_cast<EnumSchema>(this->definition.get_schema().get())) {
 		schema->elements[child->get_index()].name = name;
 		root->emit_something_changed();
 	}
 }
 
 void ResourceSchemaEditor::_enum_id_set(int id, Control* child) {
-	if (auto schema = dynamic_cast<EnumSchema*>(this->definition.get_schema().get())) {
+	if (auto schema = schema_cast<EnumSchema>(this->definition.get_schema().get())) {
 		schema->elements[child->get_index()].id = id;
 		root->emit_something_changed();
 	}
@@ -548,7 +579,6 @@ void ResourceSchemaEditor::_enum_id_set(int id, Control* child) {
 
 void ResourceSchemaEditor::_register_methods() {
 	register_method("_post_init", &ResourceSchemaEditor::_post_init);
-	register_method("_input", &ResourceSchemaEditor::_input);
 	register_method("_notification", &ResourceSchemaEditor::_notification);
 	register_method("_type_selected", &ResourceSchemaEditor::_type_selected);
 	register_method("_add_list_item", &ResourceSchemaEditor::_add_list_item);
@@ -557,6 +587,7 @@ void ResourceSchemaEditor::_register_methods() {
 	register_method("_min_value_set", &ResourceSchemaEditor::_min_value_set);
 	register_method("_max_value_set", &ResourceSchemaEditor::_max_value_set);
 	register_method("_pattern_set", &ResourceSchemaEditor::_pattern_set);
+	register_method("_ref_name_set", &ResourceSchemaEditor::_ref_name_set);
 	register_method("_child_clicked", &ResourceSchemaEditor::_child_clicked);
 	register_method("_enum_name_set", &ResourceSchemaEditor::_enum_name_set);
 	register_method("_enum_id_set", &ResourceSchemaEditor::_enum_id_set);
@@ -581,6 +612,7 @@ void ResourceSchemaEditor::_init() {
 	type_edit->get_popup()->add_item("Int", INT);
 	type_edit->get_popup()->add_item("Float", FLOAT);
 	type_edit->get_popup()->add_item("Bool", BOOL);
+	type_edit->get_popup()->add_item("Ref", REF);
 	type_edit->connect("item_selected", this, "_type_selected");
 	contents->add_child(::create_nc("Type", type_edit));
 
@@ -628,6 +660,13 @@ void ResourceSchemaEditor::_init() {
 	pattern_line->set_visible(false);
 	contents->add_child(pattern_line);
 
+	ref_name = LineEdit::_new();
+	ref_name->set_placeholder("Name of an entry in definitions");
+	ref_name->connect("text_changed", this, "_ref_name_set");
+	auto ref_name_line = ::create_nc("Definition", ref_name);
+	ref_name_line->set_visible(false);
+	contents->add_child(ref_name_line);
+
 	list = VBoxContainer::_new();
 	list->set_visible(false);
 	contents->add_child(list);
@@ -648,6 +687,13 @@ void ResourceSchemaEditor::_custom_init(ResourceSchemaInspectorProperty* root, R
 	// Updating the UI according to the incoming schema is done in _notification::READY when the child nodes are initialized
 }
 
+void ResourceSchemaEditor::set_hovered(bool hovered) {
+	if (this->hovered != hovered) {
+		this->hovered = hovered;
+		update();
+	}
+}
+
 String ResourceSchemaEditor::get_field_name() const {
 	return field_name->get_text();
 }
@@ -671,6 +717,29 @@ ResourceSchemaEditor::ResourceSchemaEditor() {
 ResourceSchemaEditor::~ResourceSchemaEditor() {
 }
 
+void ResourceSchemaInspectorProperty::_input(Ref<InputEvent> event) {
+	if (!properties->is_inside_tree()) {
+		return;
+	}
+
+	if (auto mm = Object::cast_to<InputEventMouseMotion>(event.ptr())) {
+		hover.mouse_moved(properties, get_global_mouse_position());
+		return;
+	}
+	if (auto mb = Object::cast_to<InputEventMouseButton>(event.ptr())) {
+		if (mb->get_button_index() == GlobalConstants::BUTTON_LEFT && mb->is_pressed()) {
+			for (auto target : hover.find_targets_at(properties, get_global_mouse_position())) {
+				target->emit_signal("clicked");
+			}
+		}
+		return;
+	}
+}
+
+void ResourceSchemaInspectorProperty::_hovered_exiting() {
+	hover.forget_hovered();
+}
+
 void ResourceSchemaInspectorProperty::_toggle_editor_visibility() {
 	if (properties->is_visible()) {
 		remove_child(properties);
@@ -688,11 +757,14 @@ void ResourceSchemaInspectorProperty::_prop_clicked(ResourceSchemaEditor* node)
 }
 
 void ResourceSchemaInspectorProperty::_update_btn_text() {
-	btn->set_text("Properties (size " + String::num_int64(properties->get_child_count()) + ")");
+	// Also used for ResourceSchema::definitions
+	btn->set_text(get_edited_property().capitalize() + " (size " + String::num_int64(properties->get_child_count() - 1) + ")");
 }
 
 void ResourceSchemaInspectorProperty::_register_methods() {
 	register_method("_post_init", &ResourceSchemaInspectorProperty::_post_init);
+	register_method("_input", &ResourceSchemaInspectorProperty::_input);
+	register_method("_hovered_exiting", &ResourceSchemaInspectorProperty::_hovered_exiting);
 	register_method("_toggle_editor_visibility", &ResourceSchemaInspectorProperty::_toggle_editor_visibility);
 	register_method("_prop_clicked", &ResourceSchemaInspectorProperty::_prop_clicked);
 	register_method("add_root_property", &ResourceSchemaInspectorProperty::add_root_property);
@@ -707,6 +779,9 @@ void ResourceSchemaInspectorProperty::_init() {
 	btn->connect("pressed", this, "_toggle_editor_visibility");
 	add_child(btn);
 
+	hover.is_target = [](Control* control) { return Object::cast_to<ResourceSchemaEditor>(control) != nullptr; };
+	hover.set_hovered = [](Control* control, bool hovered) { static_cast<ResourceSchemaEditor*>(control)->set_hovered(hovered); };
+
 	properties = VBoxContainer::_new();
 	properties->set_visible(false);
 
@@ -52,6 +52,7 @@ private:
 		INT,
 		FLOAT,
 		BOOL,
+		REF,
 		UNKNOWN,
 	};
 
@@ -78,6 +79,8 @@ private:
 	SpinBox* max_value;
 	// Used for STRING
 	LineEdit* pattern;
+	// Used for REF, name of the referenced definition
+	LineEdit* ref_name;
 	// Used for STRUCT, ARRAY, ENUM
 	VBoxContainer* list;
 
@@ -85,14 +88,12 @@ private:
 	NodeType schema_id = UNKNOWN;
 
 	bool removing_child = false;
-	bool mouse_inside = false;
+	bool hovered = false;
 
-	bool _is_mouse_inside();
 	void _select_type(int id, Schema* swap_out);
 	Variant _get_key();
 
 	void _post_init();
-	void _input(Ref<InputEvent> event);
 	void _notification(int what);
 	void _type_selected(int id);
 	void _add_list_item();
@@ -101,6 +102,7 @@ private:
 	void _min_value_set(real_t value);
 	void _max_value_set(real_t value);
 	void _pattern_set(const String& pattern);
+	void _ref_name_set(const String& name);
 	void _child_clicked(ResourceSchemaEditor* child);
 
 	void _enum_name_set(const String& name, Control* child);
@@ -111,6 +113,9 @@ public:
 	void _init();
 	void _custom_init(ResourceSchemaInspectorProperty* root, ResourceSchemaEditor* parent, DefinitionReference definition);
 
+	/// Set by the HoverTracker of the owning property
+	void set_hovered(bool hovered);
+
 	String get_field_name() const;
 	void set_field_name(const String& name);
 
@@ -132,7 +137,12 @@ private:
 	int selected_idx = -1;
 	bool updating = false;
 
+	// Highlights the innermost node under the mouse, and emits "clicked" on all nodes containing a click
+	HoverTracker hover{ this, "_hovered_exiting" };
+
 	void _post_init();
+	void _input(Ref<InputEvent> event);
+	void _hovered_exiting();
 	void _toggle_editor_visibility();
 	void _prop_clicked(ResourceSchemaEditor* node);
 
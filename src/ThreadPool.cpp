@@ -0,0 +1,98 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+using namespace godot::structural_inspector;
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (size_t i = 0; i < thread_count; ++i) {
+		queues.push_back(std::make_unique<Queue>());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back([this, i]() { _run(i); });
+	}
+}
+
+WorkStealingPool::~WorkStealingPool() {
+	{
+		std::lock_guard<std::mutex> lock{ state_mutex };
+		stopping = true;
+	}
+	work_available.notify_all();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+bool WorkStealingPool::_pop(size_t self, Task& task) {
+	auto& queue = *queues[self];
+	std::lock_guard<std::mutex> lock{ queue.mutex };
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.front());
+	queue.tasks.pop_front();
+	--queued;
+	return true;
+}
+
+bool WorkStealingPool::_steal(size_t self, Task& task) {
+	for (size_t offset = 1; offset < queues.size(); ++offset) {
+		auto& queue = *queues[(self + offset) % queues.size()];
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		if (!queue.tasks.empty()) {
+			// Take from the opposite end than the owner, so that the two rarely fight over the same tasks
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::_run(size_t self) {
+	while (true) {
+		Task task;
+		if (_pop(self, task) || _steal(self, task)) {
+			task();
+			if (--pending == 0) {
+				std::lock_guard<std::mutex> lock{ state_mutex };
+				all_done.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ state_mutex };
+		work_available.wait(lock, [this]() { return stopping || queued > 0; });
+		if (stopping && queued == 0) {
+			return;
+		}
+	}
+}
+
+void WorkStealingPool::submit(Task task) {
+	auto& queue = *queues[next_queue];
+	next_queue = (next_queue + 1) % queues.size();
+
+	++pending;
+	{
+		// Increment under the lock so that a worker about to sleep can't miss the wakeup
+		std::lock_guard<std::mutex> lock{ state_mutex };
+		++queued;
+	}
+	{
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.tasks.push_back(std::move(task));
+	}
+	work_available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+	std::unique_lock<std::mutex> lock{ state_mutex };
+	all_done.wait(lock, [this]() { return pending == 0; });
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+/// Fixed size thread pool where each worker has its own task queue, and idle workers steal from the back of other workers' queues.
+/// Tasks are distributed round-robin on submission, stealing evens out tasks of very different cost (e.g. a few huge resources).
+class WorkStealingPool {
+public:
+	using Task = std::function<void()>;
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+	size_t next_queue = 0;
+
+	// Tasks sitting in a queue
+	std::atomic<size_t> queued{ 0 };
+	// Tasks either queued or running
+	std::atomic<size_t> pending{ 0 };
+	bool stopping = false;
+	std::mutex state_mutex;
+	std::condition_variable work_available;
+	std::condition_variable all_done;
+
+	bool _pop(size_t self, Task& task);
+	bool _steal(size_t self, Task& task);
+	void _run(size_t self);
+
+public:
+	/// 0 means one thread per hardware thread
+	explicit WorkStealingPool(size_t thread_count = 0);
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	size_t get_thread_count() const { return threads.size(); }
+
+	void submit(Task task);
+	/// Block until every submitted task has finished
+	void wait();
+};
+
+} // namespace godot::structural_inspector
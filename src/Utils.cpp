@@ -1,8 +1,8 @@
 #include "Utils.hpp"
 
-#include <InputEvent.hpp>
-#include <InputEventMouseMotion.hpp>
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 using namespace godot;
 using namespace godot::structural_inspector;
@@ -15,25 +15,14 @@ void BorderedContainer::_notification(int what) {
 		case NOTIFICATION_DRAW: {
 			// First is regular border color, second is hovered border color
 			static const Color colors[] = { Color::hex(0x262C3BFF), Color::hex(0x333B4FFF) };
-			draw_rect(Rect2{ 4, 4, get_size().x - 4 * 2, get_size().y - 4 * 2 }, colors[mouse_inside], false, 2.0F);
+			static const Color selected_color = Color::hex(0x699CE8FF);
+			draw_rect(Rect2{ 4, 4, get_size().x - 4 * 2, get_size().y - 4 * 2 }, selected ? selected_color : colors[hovered], false, 2.0F);
 		} break;
 	}
 }
 
-void BorderedContainer::_input(Ref<InputEvent> event) {
-	if (auto mm = Object::cast_to<InputEventMouseMotion>(event.ptr())) {
-		bool current = get_global_rect().has_point(get_global_mouse_position());
-		if (mouse_inside != current) {
-			mouse_inside = current;
-			update();
-		}
-		return;
-	}
-}
-
 void BorderedContainer::_register_methods() {
 	register_method("_notification", &BorderedContainer::_notification);
-	register_method("_input", &BorderedContainer::_input);
 }
 
 void BorderedContainer::_init() {
@@ -43,84 +32,174 @@ void BorderedContainer::_init() {
 	add_constant_override("margin_bottom", 8);
 }
 
+void BorderedContainer::set_hovered(bool hovered) {
+	if (this->hovered != hovered) {
+		this->hovered = hovered;
+		update();
+	}
+}
+
+void BorderedContainer::set_selected(bool selected) {
+	if (this->selected != selected) {
+		this->selected = selected;
+		update();
+	}
+}
+
 BorderedContainer::BorderedContainer() {
 }
 
 BorderedContainer::~BorderedContainer() {
 }
 
-void ListContainer::_reorder() {
-	auto size = get_size();
+void ListContainer::_invalidate_layout() {
+	structure_dirty = true;
+	queue_sort();
+	minimum_size_changed();
+}
 
-	// TODO handle size flags
-	if (stretch) {
-		// FIXME these should be `int` in 4.0
-		float combined_length_a = 0;
-		int child_count = 0;
+void ListContainer::_update_layout_cache() {
+	// Children are rarely added or removed here, so this is checked for instead of hooking into every add_child()
+	// Note that move_child() is not detected, none of the editors reorder their children
+	if (structure_dirty || static_cast<size_t>(get_child_count()) != children.size()) {
+		children.clear();
 		for (int i = 0; i < get_child_count(); ++i) {
 			auto child = Object::cast_to<Control>(get_child(i));
-			if (!child) continue;
-			if (!child->is_visible()) continue;
-
-			auto csize = child->get_combined_minimum_size();
-			switch (dir) {
-				case HORIZONTAL: {
-					combined_length_a += csize.x;
-				} break;
-				case VERTICAL: {
-					combined_length_a += csize.y;
-				} break;
+			if (child && !child->is_connected("minimum_size_changed", this, "_child_layout_changed")) {
+				child->connect("minimum_size_changed", this, "_child_layout_changed", Array::make(child));
+				child->connect("visibility_changed", this, "_child_layout_changed", Array::make(child));
+				child->connect("tree_exiting", this, "_child_exiting", Array::make(child));
 			}
+			children.push_back({ child, Size2{}, 0, false, true });
+		}
+		first_dirty = 0;
+		first_unplaced = 0;
+		structure_dirty = false;
+	}
+
+	if (first_dirty >= children.size()) {
+		return;
+	}
+
+	float next_offset = 0;
+	if (first_dirty > 0) {
+		auto& prev = children[first_dirty - 1];
+		next_offset = prev.offset + (prev.visible ? (dir == HORIZONTAL ? prev.min_size.x : prev.min_size.y) + separation : 0);
+	}
+	for (size_t i = first_dirty; i < children.size(); ++i) {
+		auto& child = children[i];
+		if (child.dirty && child.control) {
+			child.visible = child.control->is_visible();
+			child.min_size = child.visible ? child.control->get_combined_minimum_size() : Size2{};
+		}
+		child.dirty = false;
+		child.offset = next_offset;
+		if (child.visible) {
+			next_offset += (dir == HORIZONTAL ? child.min_size.x : child.min_size.y) + separation;
+		}
+	}
+
+	// Only the cached sizes are visited here, which is cheap compared to asking every child for its minimum size
+	min_size = Size2{};
+	for (auto& child : children) {
+		if (!child.visible) continue;
+		switch (dir) {
+			case HORIZONTAL: {
+				min_size.y = std::max(min_size.y, child.min_size.y);
+			} break;
+			case VERTICAL: {
+				min_size.x = std::max(min_size.x, child.min_size.x);
+			} break;
+		}
+	}
+	switch (dir) {
+		case HORIZONTAL: {
+			min_size.x = next_offset - separation;
+		} break;
+		case VERTICAL: {
+			min_size.y = next_offset - separation;
+		} break;
+	}
+
+	first_unplaced = std::min(first_unplaced, first_dirty);
+	first_dirty = children.size();
+}
+
+void ListContainer::_child_layout_changed(Control* child) {
+	// The child may have been moved to another parent since the signal was connected
+	if (child->get_parent() != this) return;
+
+	size_t idx = child->get_index();
+	if (idx < children.size() && children[idx].control == child) {
+		children[idx].dirty = true;
+		first_dirty = std::min(first_dirty, idx);
+	} else {
+		structure_dirty = true;
+	}
+}
+
+void ListContainer::_child_exiting(Control* child) {
+	if (child->get_parent() == this) {
+		structure_dirty = true;
+	}
+}
+
+void ListContainer::_reorder() {
+	_update_layout_cache();
 
-			++child_count;
+	auto size = get_size();
+	if (size != placed_size) {
+		placed_size = size;
+		first_unplaced = 0;
+	}
+
+	// TODO handle size flags
+	if (stretch) {
+		// Every child gets the same length, so all of them move whenever anything changes
+		int visible_count = 0;
+		for (auto& child : children) {
+			if (child.visible) ++visible_count;
 		}
 
+		// FIXME these should be `int` in 4.0
 		float combined_length = dir == HORIZONTAL ? size.x : size.y;
-		float unit_length = combined_length / child_count;
+		float unit_length = combined_length / visible_count;
 		Point2 next_pos{ 0, 0 };
-		for (int i = 0; i < get_child_count(); ++i) {
-			auto child = Object::cast_to<Control>(get_child(i));
-			if (!child) continue;
-			if (!child->is_visible()) continue;
+		for (auto& child : children) {
+			if (!child.visible) continue;
 
-			auto csize = child->get_combined_minimum_size();
 			switch (dir) {
 				case HORIZONTAL: {
-					child->set_position(next_pos);
+					child.control->set_position(next_pos);
 					// TODO take child minimum size into account
-					child->set_size({ unit_length, size.y });
+					child.control->set_size({ unit_length, size.y });
 					next_pos = { next_pos.x + unit_length + separation, next_pos.y };
 				} break;
 				case VERTICAL: {
-					child->set_position(next_pos);
-					child->set_size({ size.x, unit_length });
+					child.control->set_position(next_pos);
+					child.control->set_size({ size.x, unit_length });
 					next_pos = { next_pos.x, next_pos.y + unit_length + separation };
 				} break;
 			}
 		}
 	} else {
-		Point2 next_pos{ 0, 0 };
-		for (int i = 0; i < get_child_count(); ++i) {
-			auto child = Object::cast_to<Control>(get_child(i));
-			if (!child) continue;
-			if (!child->is_visible()) continue;
-
-			auto csize = child->get_combined_minimum_size();
+		for (size_t i = first_unplaced; i < children.size(); ++i) {
+			auto& child = children[i];
+			if (!child.visible) continue;
 
 			switch (dir) {
 				case HORIZONTAL: {
-					child->set_position(next_pos);
-					child->set_size({ csize.x, size.y });
-					next_pos = { next_pos.x + csize.x + separation, next_pos.y };
+					child.control->set_position({ child.offset, 0 });
+					child.control->set_size({ child.min_size.x, size.y });
 				} break;
 				case VERTICAL: {
-					child->set_position(next_pos);
-					child->set_size({ size.x, csize.y });
-					next_pos = { next_pos.x, next_pos.y + csize.y + separation };
+					child.control->set_position({ 0, child.offset });
+					child.control->set_size({ size.x, child.min_size.y });
 				} break;
 			}
 		}
 	}
+	first_unplaced = children.size();
 }
 
 void ListContainer::_notification(int what) {
@@ -128,36 +207,23 @@ void ListContainer::_notification(int what) {
 		case NOTIFICATION_SORT_CHILDREN: {
 			_reorder();
 		} break;
+		// Children may have been added or removed while outside the tree, without any signal reaching us
+		case NOTIFICATION_ENTER_TREE: {
+			structure_dirty = true;
+		} break;
 	}
 }
 
 Size2 ListContainer::_get_minimum_size() {
-	Size2 min_size;
-	for (int i = 0; i < get_child_count(); ++i) {
-		auto child = Object::cast_to<Control>(get_child(i));
-		if (!child) continue;
-		if (!child->is_visible()) continue;
-
-		auto csize = child->get_combined_minimum_size();
-		switch (dir) {
-			case HORIZONTAL: {
-				min_size.x += csize.x + separation;
-				min_size.y = std::max(min_size.y, csize.y);
-			} break;
-			case VERTICAL: {
-				min_size.x = std::max(min_size.x, csize.x);
-				min_size.y += csize.y + separation;
-			} break;
-		}
-	}
-	min_size.x -= separation;
-	min_size.y -= separation;
+	_update_layout_cache();
 	return min_size;
 }
 
 void ListContainer::_register_methods() {
 	// register_method("_notification", &ListContainer::_notification);
 	// register_method("_get_minimum_size", &ListContainer::_get_minimum_size);
+	register_method("_child_layout_changed", &ListContainer::_child_layout_changed);
+	register_method("_child_exiting", &ListContainer::_child_exiting);
 }
 
 void ListContainer::_init() {
@@ -169,7 +235,7 @@ ListContainer::Direction ListContainer::get_direction() const {
 
 void ListContainer::set_direction(Direction dir) {
 	this->dir = dir;
-	queue_sort();
+	_invalidate_layout();
 }
 
 int ListContainer::get_separation() const {
@@ -178,7 +244,7 @@ int ListContainer::get_separation() const {
 
 void ListContainer::set_separation(int separation) {
 	this->separation = separation;
-	queue_sort();
+	_invalidate_layout();
 }
 
 bool ListContainer::is_stretching() const {
@@ -187,7 +253,7 @@ bool ListContainer::is_stretching() const {
 
 void ListContainer::set_stretching(bool stretch) {
 	this->stretch = stretch;
-	queue_sort();
+	_invalidate_layout();
 }
 
 ListContainer::ListContainer() {
@@ -196,6 +262,59 @@ ListContainer::ListContainer() {
 ListContainer::~ListContainer() {
 }
 
+HoverTracker::HoverTracker(Object* owner, String exiting_method) :
+		owner{ owner }, exiting_method{ exiting_method } {}
+
+std::vector<Control*> HoverTracker::find_targets_at(Control* root, Vector2 point) const {
+	std::vector<Control*> targets;
+	if (!root || !root->is_visible_in_tree() || !root->get_global_rect().has_point(point)) {
+		return targets;
+	}
+
+	auto node = root;
+	while (true) {
+		// Later children are drawn on top
+		Control* next = nullptr;
+		for (int i = node->get_child_count() - 1; i >= 0; --i) {
+			auto child = Object::cast_to<Control>(node->get_child(i));
+			if (child && child->is_visible() && child->get_global_rect().has_point(point)) {
+				next = child;
+				break;
+			}
+		}
+		if (!next) break;
+
+		if (is_target(next)) {
+			targets.push_back(next);
+		}
+		node = next;
+	}
+	return targets;
+}
+
+void HoverTracker::mouse_moved(Control* root, Vector2 point) {
+	auto targets = find_targets_at(root, point);
+	set_hovered_control(targets.empty() ? nullptr : targets.back());
+}
+
+void HoverTracker::set_hovered_control(Control* control) {
+	if (hovered == control) return;
+
+	if (hovered) {
+		set_hovered(hovered, false);
+		hovered->disconnect("tree_exiting", owner, exiting_method);
+	}
+	hovered = control;
+	if (hovered) {
+		set_hovered(hovered, true);
+		hovered->connect("tree_exiting", owner, exiting_method);
+	}
+}
+
+void HoverTracker::forget_hovered() {
+	set_hovered_control(nullptr);
+}
+
 String godot::structural_inspector::format_variant(const Variant& variant) {
 	switch (variant.get_type()) {
 		case Variant::DICTIONARY: return "dictionary";
@@ -221,6 +340,51 @@ String godot::structural_inspector::format_variant(const Variant& variant) {
 	}
 }
 
+bool godot::structural_inspector::variant_equals(const Variant& a, const Variant& b) {
+	// Nested containers are compared from a work list instead of recursively
+	std::vector<std::pair<Variant, Variant>> pending{ { a, b } };
+	while (!pending.empty()) {
+		auto [x, y] = std::move(pending.back());
+		pending.pop_back();
+
+		if (x.get_type() != y.get_type()) {
+			return false;
+		}
+		switch (x.get_type()) {
+			case Variant::ARRAY: {
+				const Array xa = x;
+				const Array ya = y;
+				if (xa.size() != ya.size()) {
+					return false;
+				}
+				for (int i = 0; i < xa.size(); ++i) {
+					pending.emplace_back(xa[i], ya[i]);
+				}
+			} break;
+			case Variant::DICTIONARY: {
+				const Dictionary xd = x;
+				const Dictionary yd = y;
+				if (xd.size() != yd.size()) {
+					return false;
+				}
+				Array keys = xd.keys();
+				for (int i = 0; i < keys.size(); ++i) {
+					if (!yd.has(keys[i])) {
+						return false;
+					}
+					pending.emplace_back(xd[keys[i]], yd[keys[i]]);
+				}
+			} break;
+			default: {
+				if (x != y) {
+					return false;
+				}
+			} break;
+		}
+	}
+	return true;
+}
+
 size_t std::hash<String>::operator()(const String& str) const noexcept {
 	return str.hash();
 }
@@ -7,6 +7,7 @@
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <vector>
 
 namespace godot::structural_inspector {
 
@@ -30,19 +31,26 @@ public:
 class BorderedContainer : public MarginContainer {
 	GODOT_CLASS(BorderedContainer, MarginContainer)
 private:
-	bool mouse_inside;
+	bool hovered = false;
+	bool selected = false;
 
 	void _notification(int what);
-	void _input(Ref<InputEvent> event);
 
 public:
 	static void _register_methods();
 	void _init();
 
+	/// Set by the HoverTracker of the owning property
+	void set_hovered(bool hovered);
+	/// Set by the ArrayEditor showing this container as one of its rows
+	void set_selected(bool selected);
+
 	BorderedContainer();
 	~BorderedContainer();
 };
 
+/// Lays out its children one after another. Minimum sizes and positions are cached per child and only recomputed for children
+/// that reported a change (through `minimum_size_changed` or `visibility_changed`); only the children from the first changed one onwards get moved.
 class ListContainer : public Container {
 	GODOT_CLASS(ListContainer, Container)
 public:
@@ -52,10 +60,34 @@ public:
 	};
 
 private:
+	struct CachedChild {
+		// nullptr for children that aren't a Control, kept so that indices match get_child()
+		Control* control;
+		Size2 min_size;
+		// Position along the list direction
+		float offset;
+		bool visible;
+		bool dirty;
+	};
+
 	Direction dir = VERTICAL;
 	int separation = 2;
 	bool stretch = false;
 
+	std::vector<CachedChild> children;
+	// Children before `first_dirty` have an up to date min_size and offset, children before `first_unplaced` are positioned
+	size_t first_dirty = 0;
+	size_t first_unplaced = 0;
+	// Set when a child leaves, the cache is also rebuilt when the child count changes
+	bool structure_dirty = true;
+	Size2 min_size;
+	// Our size when the children were last positioned, a different size moves all of them
+	Size2 placed_size;
+
+	void _invalidate_layout();
+	void _update_layout_cache();
+	void _child_layout_changed(Control* child);
+	void _child_exiting(Control* child);
 	void _reorder();
 
 protected:
@@ -79,7 +111,36 @@ public:
 	~ListContainer();
 };
 
+/// Hover and click tracking for a whole tree of nested controls, done once per mouse event by the top-level property.
+/// This replaces an _input() handler on every bordered control, each of which hit tested every mouse event.
+class HoverTracker {
+private:
+	Control* hovered = nullptr;
+	// Receives the hovered control's "tree_exiting" signal, so that `hovered` never dangles
+	Object* owner;
+	String exiting_method;
+
+public:
+	/// Whether a control takes part in hovering and clicking
+	std::function<bool(Control*)> is_target;
+	/// Redraw `control` as (not) hovered
+	std::function<void(Control*, bool)> set_hovered;
+
+	/// `exiting_method` is a method of `owner` that must call forget_hovered()
+	HoverTracker(Object* owner, String exiting_method);
+
+	/// Targets under `point` below `root`, outermost first.
+	/// Only descends into the children that contain the point, so the cost depends on the depth and not on the total number of controls.
+	std::vector<Control*> find_targets_at(Control* root, Vector2 point) const;
+	/// Hovers the innermost target under `point`, only the previously and newly hovered controls get redrawn
+	void mouse_moved(Control* root, Vector2 point);
+	void set_hovered_control(Control* control);
+	void forget_hovered();
+};
+
 String format_variant(const Variant& variant);
+/// Deep comparison, Godot compares dictionaries by reference
+bool variant_equals(const Variant& a, const Variant& b);
 
 } // namespace godot::structural_inspector
 
@@ -0,0 +1,220 @@
+#include "Validation.hpp"
+
+#include <utility>
+
+using namespace godot;
+using namespace godot::structural_inspector;
+
+String SchemaValidator::_format_path() const {
+	String result;
+	for (auto& segment : path) {
+		if (segment.name) {
+			if (!result.empty()) {
+				result += ".";
+			}
+			result += *segment.name;
+		} else {
+			result += "[" + String::num_int64(segment.index) + "]";
+		}
+	}
+	return result;
+}
+
+void SchemaValidator::_error(const String& message) {
+	errors->push_back({ _format_path(), message });
+}
+
+static bool is_number(const Variant& value) {
+	return value.get_type() == Variant::INT || value.get_type() == Variant::REAL;
+}
+
+void SchemaValidator::_validate(const Task& task) {
+	auto& node = *task.node;
+	auto& value = task.value;
+	path.resize(task.path_size);
+	if (task.has_segment) {
+		path.push_back(task.segment);
+	}
+
+	if ((node.kind == SchemaKind::STRUCT || node.kind == SchemaKind::ARRAY) && task.depth >= max_depth) {
+		_error("Nested deeper than " + String::num_int64(max_depth) + " levels, see the " + MAX_SCHEMA_DEPTH_SETTING + " project setting");
+		return;
+	}
+
+	switch (node.kind) {
+		case SchemaKind::STRUCT: {
+			if (value.get_type() != Variant::DICTIONARY) {
+				_error("Expected dictionary, found " + format_variant(value));
+				return;
+			}
+
+			Dictionary dict = value;
+			int found = 0;
+			uint32_t path_size = path.size();
+			// Pushed in reverse, so that fields are checked (and their errors reported) in order
+			for (uint32_t i = node.count; i-- > 0;) {
+				auto& field = schema->get_field(node, i);
+				if (dict.has(field.name)) {
+					++found;
+					tasks.push_back({ &schema->get_node(field.node), dict[field.name], path_size, true, { &field.name, 0 }, task.depth + 1 });
+				} else {
+					path.push_back({ &field.name, 0 });
+					_error("Missing field");
+					path.pop_back();
+				}
+			}
+
+			// Only pay for listing the keys when we know there is something to report
+			if (dict.size() > found) {
+				Array keys = dict.keys();
+				for (int i = 0; i < keys.size(); ++i) {
+					bool known = false;
+					for (uint32_t j = 0; j < node.count; ++j) {
+						if (keys[i] == Variant{ schema->get_field(node, j).name }) {
+							known = true;
+							break;
+						}
+					}
+					if (!known) {
+						String key = keys[i];
+						_error("Unknown field " + key);
+					}
+				}
+			}
+		} break;
+
+		case SchemaKind::ARRAY: {
+			if (value.get_type() != Variant::ARRAY) {
+				_error("Expected array, found " + format_variant(value));
+				return;
+			}
+
+			Array array = value;
+			int size = array.size();
+			if (size < node.array.min_elements) {
+				_error("Expected at least " + String::num_int64(node.array.min_elements) + " elements, found " + String::num_int64(size));
+			}
+			if (size > node.array.max_elements) {
+				_error("Expected at most " + String::num_int64(node.array.max_elements) + " elements, found " + String::num_int64(size));
+			}
+
+			auto& element_type = schema->get_element_type(node);
+			uint32_t path_size = path.size();
+			for (int i = size; i-- > 0;) {
+				tasks.push_back({ &element_type, array[i], path_size, true, { nullptr, i }, task.depth + 1 });
+			}
+		} break;
+
+		case SchemaKind::STRING: {
+			if (value.get_type() != Variant::STRING) {
+				_error("Expected string, found " + format_variant(value));
+				return;
+			}
+
+			if (auto pattern = schema->get_pattern(node)) {
+				String string = value;
+				if (!pattern->matches(string)) {
+					_error("\"" + string + "\" does not match pattern " + pattern->get_source());
+				}
+			}
+		} break;
+
+		case SchemaKind::ENUM: {
+			if (value.get_type() != Variant::INT) {
+				_error("Expected enum id, found " + format_variant(value));
+				return;
+			}
+
+			int id = value;
+			for (uint32_t i = 0; i < node.count; ++i) {
+				if (schema->get_enum_value(node, i).id == id) {
+					return;
+				}
+			}
+			_error(String::num_int64(id) + " is not a valid enum id");
+		} break;
+
+		case SchemaKind::INT: {
+			if (value.get_type() != Variant::INT) {
+				_error("Expected int, found " + format_variant(value));
+				return;
+			}
+
+			int64_t n = value;
+			if (n < node.int_range.min_value || n > node.int_range.max_value) {
+				_error(String::num_int64(n) + " is out of range [" + String::num_int64(node.int_range.min_value) + ", " + String::num_int64(node.int_range.max_value) + "]");
+			}
+		} break;
+
+		case SchemaKind::FLOAT: {
+			// Integral floats may be stored as ints, so accept both
+			if (!is_number(value)) {
+				_error("Expected float, found " + format_variant(value));
+				return;
+			}
+
+			double n = value;
+			if (n < node.float_range.min_value || n > node.float_range.max_value) {
+				_error(String::num(n) + " is out of range [" + String::num(node.float_range.min_value) + ", " + String::num(node.float_range.max_value) + "]");
+			}
+		} break;
+
+		case SchemaKind::BOOL: {
+			if (value.get_type() != Variant::BOOL) {
+				_error("Expected bool, found " + format_variant(value));
+			}
+		} break;
+
+		case SchemaKind::REF: {
+			// Recursive types need a way to end, so null is accepted wherever a definition refers back to itself
+			if (node.ref.recursive && value.get_type() == Variant::NIL) {
+				return;
+			}
+
+			auto target = schema->resolve(node);
+			if (!target) {
+				_error("Unresolved reference to definition " + schema->get_ref_name(node));
+				return;
+			}
+			tasks.push_back({ target, value, static_cast<uint32_t>(path.size()), false, {}, task.depth });
+		} break;
+	}
+}
+
+bool SchemaValidator::validate(const CompiledSchema& schema, const SchemaNode& node, const Variant& value, const String& root_name, std::vector<ValidationError>& errors) {
+	this->schema = &schema;
+	this->errors = &errors;
+	auto errors_before = errors.size();
+
+	max_depth = get_max_schema_depth();
+
+	path.clear();
+	tasks.clear();
+	tasks.push_back({ &node, value, 0, !root_name.empty(), { &root_name, 0 }, 0 });
+	while (!tasks.empty()) {
+		auto task = std::move(tasks.back());
+		tasks.pop_back();
+		_validate(task);
+	}
+
+	this->schema = nullptr;
+	this->errors = nullptr;
+	return errors.size() == errors_before;
+}
+
+std::vector<ValidationError> godot::structural_inspector::validate(const CompiledSchema& schema, const SchemaNode& node, const Variant& value, const String& root_name) {
+	std::vector<ValidationError> errors;
+	SchemaValidator{}.validate(schema, node, value, root_name, errors);
+	return errors;
+}
+
+Array godot::structural_inspector::errors_to_array(const std::vector<ValidationError>& errors) {
+	Array result;
+	for (auto& [path, message] : errors) {
+		Dictionary error;
+		error["path"] = path;
+		error["message"] = message;
+		result.append(error);
+	}
+	return result;
+}
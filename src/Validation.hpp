@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CompiledSchema.hpp"
+
+#include <Godot.hpp>
+#include <String.hpp>
+#include <Variant.hpp>
+#include <vector>
+
+namespace godot::structural_inspector {
+
+struct ValidationError {
+	// e.g. `contents[3].nested_array[1].b`
+	String path;
+	String message;
+};
+
+/// Checks values against a CompiledSchema in a single walk.
+/// The object keeps its path buffer around between calls, so that validating a value that passes does not allocate per visited node;
+/// reuse one validator for repeated validations.
+/// Values nested deeper than get_max_schema_depth() (e.g. a dictionary that contains itself) are reported as an error instead of being walked.
+class SchemaValidator {
+private:
+	struct PathSegment {
+		// nullptr for array indices
+		const String* name;
+		int index;
+	};
+
+	struct Task {
+		const SchemaNode* node;
+		Variant value;
+		// Length of `path` before this task's segment, the path is cut back to it when the task is processed
+		uint32_t path_size;
+		// Not pushed for the root and for references, which don't add a level to the path
+		bool has_segment;
+		PathSegment segment;
+		// Number of dictionaries and arrays around the value
+		int depth;
+	};
+
+	const CompiledSchema* schema = nullptr;
+	std::vector<ValidationError>* errors = nullptr;
+	std::vector<PathSegment> path;
+	// Explicit work stack, recursive definitions make the depth of the data unbounded
+	std::vector<Task> tasks;
+	int max_depth = 0;
+
+	String _format_path() const;
+	void _error(const String& message);
+	void _validate(const Task& task);
+
+public:
+	/// Appends all problems found to `errors`, returns true if there were none.
+	/// `root_name` is used as the first segment of error paths, and may be empty.
+	bool validate(const CompiledSchema& schema, const SchemaNode& node, const Variant& value, const String& root_name, std::vector<ValidationError>& errors);
+};
+
+std::vector<ValidationError> validate(const CompiledSchema& schema, const SchemaNode& node, const Variant& value, const String& root_name = "");
+/// Convert to an Array of `{ "path": ..., "message": ... }` dictionaries, for exposing to scripts
+Array errors_to_array(const std::vector<ValidationError>& errors);
+
+} // namespace godot::structural_inspector
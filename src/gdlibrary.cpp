@@ -1,8 +1,13 @@
+#include "EditHistory.hpp"
 #include "Plugin.hpp"
+#include "ProjectValidator.hpp"
 #include "ResourceEditor.hpp"
 #include "Schema.hpp"
 #include "SchemaEditor.hpp"
 #include "Utils.hpp"
+#ifdef STRUCTURAL_INSPECTOR_BENCHMARKS
+#include "Benchmarks.hpp"
+#endif
 
 #include <Godot.hpp>
 
@@ -23,11 +28,18 @@ extern "C" void GDN_EXPORT godot_nativescript_init(void* handle) {
 	godot::register_tool_class<Plugin>();
 	godot::register_tool_class<InspectorPlugin>();
 	godot::register_tool_class<ResourceSchema>();
+	godot::register_tool_class<EditHistory>();
 	godot::register_tool_class<ResourceEditor>();
 	godot::register_tool_class<StructEditor>();
 	godot::register_tool_class<ArrayEditor>();
 	godot::register_tool_class<ValueEditor>();
+	godot::register_tool_class<RefEditor>();
 	godot::register_tool_class<ResourceInspectorProperty>();
 	godot::register_tool_class<ResourceSchemaEditor>();
 	godot::register_tool_class<ResourceSchemaInspectorProperty>();
+	godot::register_tool_class<ProjectValidator>();
+#ifdef STRUCTURAL_INSPECTOR_BENCHMARKS
+	godot::register_tool_class<BenchmarkList>();
+	godot::register_tool_class<Benchmarks>();
+#endif
 }